@@ -0,0 +1,31 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// counts heap allocations, so benchmarks can check they don't
+// allocate in their steady state
+
+static std::atomic<std::size_t> allocs{0};
+
+std::size_t alloc_count()
+{
+    return allocs.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size)
+{
+    allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
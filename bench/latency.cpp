@@ -0,0 +1,248 @@
+#include "fmt/format.h"
+#include "lua/config.h"
+#include "rw/logging.h"
+#include "rwte/coords.h"
+#include "rwte/headless.h"
+#include "rwte/reactor.h"
+#include "rwte/renderer.h"
+#include "rwte/rwte.h"
+#include "rwte/screen.h"
+#include "rwte/term.h"
+#include "rwte/tty.h"
+#include "rwte/window.h"
+
+#include <algorithm>
+#include <array>
+#include <cairo/cairo.h>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <sys/wait.h>
+#include <termios.h>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#define LOGGER() (rw::logging::get("rwte-bench"))
+
+using namespace std::chrono;
+
+namespace {
+
+// stages of the path from a key being written to the tty to the
+// frame showing its echo being drawn
+enum Stage
+{
+    Write,    // Tty::write, to the pty or its buffer
+    Echo,     // until the reactor wakes to read the echo
+    Parse,    // Tty::read_ready, until the echo is all on screen
+    Schedule, // until the refresh comes round to drawing
+    Draw,     // drawregion onto the surface
+    Total,
+    StageCount
+};
+
+constexpr std::array<const char*, StageCount> stage_names = {
+        "write", "echo", "parse", "schedule", "draw", "total"};
+
+// a window drawing with the real renderer onto an image surface.
+// like the wayland window, draw only asks for a frame; the loop
+// draws it once the event that asked has been handled.
+class BenchWindow : public Window
+{
+public:
+    explicit BenchWindow(term::Term* term) :
+        m_term(term),
+        m_renderer(term)
+    {
+        auto font_surface = cairo_image_surface_create(
+                CAIRO_FORMAT_ARGB32, 20, 20);
+        m_renderer.load_font(font_surface);
+        cairo_surface_destroy(font_surface);
+
+        const int border_px = lua::config::get_int("border_px", 2);
+        const int width = term->cols() * m_renderer.charwidth() + 2 * border_px;
+        const int height = term->rows() * m_renderer.charheight() + 2 * border_px;
+
+        // renderer takes ownership of the surface
+        m_renderer.set_surface(cairo_image_surface_create(
+                                       CAIRO_FORMAT_ARGB32, width, height),
+                width, height);
+    }
+
+#if !defined(BUILD_WAYLAND_ONLY)
+    uint32_t windowid() const { return 0; }
+#endif
+
+    int fd() const { return -1; }
+    void prepare() {}
+    bool event() { return false; }
+    bool check() { return false; }
+
+    void draw() { m_pending = true; }
+
+    void settitle(std::string_view name) {}
+    void seturgent(bool urgent) {}
+    void bell(int volume) {}
+
+    void setsel() {}
+    void selpaste() {}
+    void setclip() {}
+    void clippaste() {}
+
+    bool pending() const { return m_pending; }
+
+    void frame()
+    {
+        m_pending = false;
+        m_renderer.drawregion({0, 0}, {m_term->rows(), m_term->cols()});
+    }
+
+private:
+    term::Term* m_term;
+    renderer::Renderer m_renderer;
+    bool m_pending = false;
+};
+
+} // namespace
+
+static double percentile(std::vector<double> v, double p)
+{
+    if (v.empty())
+        return 0;
+
+    auto n = static_cast<std::size_t>(p * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + n, v.end());
+    return v[n];
+}
+
+// whether text is on screen at the start of the cursor's row, with
+// the cursor just past it
+static bool echoed(const term::Term& term, std::string_view text)
+{
+    const auto view = term.snapshot();
+    const auto& cursor = view.cursor();
+    if (cursor.col != static_cast<int>(text.size()))
+        return false;
+
+    for (std::size_t i = 0; i < text.size(); i++) {
+        const Cell cell{cursor.row, static_cast<int>(i)};
+        if (view.glyph(cell).u != static_cast<char32_t>(text[i]))
+            return false;
+    }
+    return true;
+}
+
+// types samples tagged keys into a Tty whose child, cat on a raw pty,
+// echoes them back like a shell would. the reactor runs the loop as
+// rwte's main does: tty reads feed the term, refreshes go through
+// Rwte, and frames are drawn by the renderer. each stage is stamped
+// where it happens, and reported per stage in usec.
+static void bench_latency_mode(int samples, bool throttledraw)
+{
+    const bool oldthrottle = std::exchange(options.throttledraw, throttledraw);
+    const auto oldcmd = std::exchange(options.cmd, {"cat"});
+
+    reactor::Reactor r;
+    headless::Headless h{80, 24, &r};
+    auto& term = h.term();
+
+    auto window = std::make_shared<BenchWindow>(&term);
+    rwte->setWindow(window);
+    term.setWindow(window);
+
+    auto tty = std::make_shared<Tty>(h.bus(), &r, h.termptr());
+    tty->open(window.get());
+
+    // raw before anything's typed, so only cat echoes
+    termios raw{};
+    if (tcgetattr(tty->fd(), &raw) < 0)
+        LOGGER()->fatal("tcgetattr failed: {}", strerror(errno));
+    cfmakeraw(&raw);
+    if (tcsetattr(tty->fd(), TCSANOW, &raw) < 0)
+        LOGGER()->fatal("tcsetattr failed: {}", strerror(errno));
+
+    r.set_ttyfd(tty->fd());
+
+    std::array<std::vector<double>, StageCount> times;
+
+    auto usecs = [](steady_clock::time_point a, steady_clock::time_point b) {
+        return duration<double, std::micro>(b - a).count();
+    };
+
+    for (int i = 0; i < samples; i++) {
+        // a unique tag, drawn over the last at the start of the row
+        const auto tag = fmt::format("k{};", i);
+        std::optional<steady_clock::time_point> t2, t3;
+
+        auto t0 = steady_clock::now();
+        tty->write("\r" + tag);
+        auto t1 = steady_clock::now();
+
+        for (;;) {
+            const auto evt = r.wait();
+            const auto woke = steady_clock::now();
+
+            if (std::holds_alternative<reactor::TtyRead>(evt)) {
+                if (!t2)
+                    t2 = woke;
+                tty->read_ready();
+                if (!t3 && echoed(term, tag))
+                    t3 = steady_clock::now();
+            } else if (std::holds_alternative<reactor::TtyWrite>(evt)) {
+                tty->write_ready();
+            } else if (std::holds_alternative<reactor::Refresh>(evt)) {
+                rwte->flushcb();
+            } else if (std::holds_alternative<reactor::ChildEnd>(evt) ||
+                       std::holds_alternative<reactor::Stop>(evt)) {
+                LOGGER()->fatal("echo child went away");
+            }
+
+            if (!window->pending())
+                continue;
+
+            // frames drawn before the echo is all in are part of the
+            // cost, but the sample ends with the first one after
+            auto t4 = steady_clock::now();
+            window->frame();
+            auto t5 = steady_clock::now();
+
+            if (t3) {
+                times[Write].push_back(usecs(t0, t1));
+                times[Echo].push_back(usecs(t1, *t2));
+                times[Parse].push_back(usecs(*t2, *t3));
+                times[Schedule].push_back(usecs(*t3, t4));
+                times[Draw].push_back(usecs(t4, t5));
+                times[Total].push_back(usecs(t0, t5));
+                break;
+            }
+        }
+    }
+
+    tty->hup();
+    waitpid(-1, nullptr, 0);
+
+    fmt::print("latency {}, {} samples (us)\n",
+            throttledraw ? "with the 1/60s refresh timer" : "drawing on refresh",
+            samples);
+    for (int s = 0; s < StageCount; s++) {
+        fmt::print("  {:<9} p50 {:>9.1f}  p99 {:>9.1f}  max {:>9.1f}\n",
+                stage_names[s], percentile(times[s], 0.5),
+                percentile(times[s], 0.99), percentile(times[s], 1.0));
+    }
+
+    rwte->setWindow(nullptr);
+    options.cmd = oldcmd;
+    options.throttledraw = oldthrottle;
+}
+
+void bench_latency(int samples)
+{
+    // once throttled by the refresh timer, as with xcb, and once
+    // drawing as soon as a refresh is asked for, as when the wayland
+    // window throttles, to show what the timer costs
+    bench_latency_mode(samples, true);
+    bench_latency_mode(samples, false);
+}
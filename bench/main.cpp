@@ -3,18 +3,78 @@
 
 #include "rw/logging.h"
 #include "rw/utf8.h"
+#include "rwte/recording.h"
+
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #define LOGGER() (rw::logging::get("rwte-bench"))
 
 // todo: better way than extern.
 
 void bench_string_cmp(ankerl::nanobench::Config& cfg);
+void bench_parser(ankerl::nanobench::Config& cfg);
+void bench_screen(ankerl::nanobench::Config& cfg);
+void bench_renderer(ankerl::nanobench::Config& cfg);
+void bench_term_files(ankerl::nanobench::Config& cfg,
+        const std::vector<std::string>& paths);
+void bench_replay(const std::string& path, bool realtime);
+void bench_latency(int samples);
 
-int main()
+int main(int argc, char* argv[])
 {
     rw::utf8::set_locale();
 
+    // any args are pty streams to feed a headless term; recordings
+    // made with rwte --record are replayed with their timing, raw
+    // streams are fed as fast as possible. --json writes the
+    // nanobench results to a file, for comparing across commits.
+    // --latency measures keypress to frame through an echoing pty
+    bool realtime = false;
+    bool latency = false;
+    std::string json;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg{argv[i]};
+        if (arg == "--realtime")
+            realtime = true;
+        else if (arg == "--latency")
+            latency = true;
+        else if (arg == "--json" && i + 1 < argc)
+            json = argv[++i];
+        else
+            paths.emplace_back(arg);
+    }
+
     auto cfg = ankerl::nanobench::Config();
 
-    bench_string_cmp(cfg);
+    if (latency) {
+        bench_latency(200);
+    } else if (paths.empty()) {
+        bench_string_cmp(cfg);
+        bench_parser(cfg);
+        bench_screen(cfg);
+        bench_renderer(cfg);
+    } else {
+        std::vector<std::string> raw;
+        for (const auto& path : paths) {
+            if (recording::isrecording(path))
+                bench_replay(path, realtime);
+            else
+                raw.push_back(path);
+        }
+
+        if (!raw.empty())
+            bench_term_files(cfg, raw);
+    }
+
+    if (!json.empty()) {
+        std::ofstream out{json};
+        if (!out)
+            LOGGER()->fatal("could not open {}", json);
+
+        cfg.render(ankerl::nanobench::templates::json(), out);
+    }
 }
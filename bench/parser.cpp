@@ -0,0 +1,239 @@
+#include "fmt/format.h"
+#include "nanobench.h"
+#include "rw/utf8.h"
+#include "rwte/headless.h"
+
+#include <array>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std::literals;
+
+// todo: better way than extern.
+double last_mbps(const ankerl::nanobench::Config& cfg);
+
+// size of each generated corpus
+constexpr std::size_t corpus_size = 64 * 1024;
+
+constexpr std::array words = {
+        "int"sv, "return"sv, "const"sv, "auto"sv, "std::string"sv,
+        "if"sv, "for"sv, "while"sv, "nullptr"sv, "template"sv,
+        "drwxr-xr-x"sv, "README.md"sv, "src"sv, "-rw-r--r--"sv,
+        "4096"sv, "Oct"sv, "main.cpp"sv, "+++"sv, "@@"sv, "//"sv};
+
+namespace {
+
+// generates a corpus of at least corpus_size bytes; seeded so
+// every run (and every commit) sees the same bytes
+class Corpus
+{
+public:
+    Corpus() : m_rng(0x5eed) {}
+
+    int rand(int lo, int hi)
+    {
+        return std::uniform_int_distribution<int>{lo, hi}(m_rng);
+    }
+
+    std::string_view word() { return words[rand(0, words.size() - 1)]; }
+
+    void put(std::string_view s) { m_out.append(s); }
+
+    void putc(char32_t u)
+    {
+        std::array<char, utf_size> c;
+        m_out.append(c.begin(), utf8encode(u, c.begin()));
+    }
+
+    bool full() const { return m_out.size() >= corpus_size; }
+
+    std::string take() { return std::move(m_out); }
+
+private:
+    std::mt19937 m_rng;
+    std::string m_out;
+};
+
+} // namespace
+
+// plain text, like cat of a source file
+static std::string gen_ascii()
+{
+    Corpus c;
+    while (!c.full()) {
+        for (int col = 0; col < 72;) {
+            auto w = c.word();
+            c.put(w);
+            c.put(" ");
+            col += w.size() + 1;
+        }
+        c.put("\r\n");
+    }
+    return c.take();
+}
+
+// a color change every word or two, like ls --color or a
+// highlighted diff
+static std::string gen_sgr()
+{
+    Corpus c;
+    while (!c.full()) {
+        for (int i = 0; i < 10; i++) {
+            switch (c.rand(0, 3)) {
+                case 0:
+                    c.put(fmt::format("\033[{};{}m", c.rand(0, 1),
+                            c.rand(30, 37)));
+                    break;
+                case 1:
+                    c.put(fmt::format("\033[38;5;{}m", c.rand(0, 255)));
+                    break;
+                case 2:
+                    c.put(fmt::format("\033[38;2;{};{};{}m", c.rand(0, 255),
+                            c.rand(0, 255), c.rand(0, 255)));
+                    break;
+                default:
+                    c.put("\033[1;4;7m");
+                    break;
+            }
+            c.put(c.word());
+            c.put("\033[0m ");
+        }
+        c.put("\r\n");
+    }
+    return c.take();
+}
+
+// full screen redraws with absolute cursor moves, like a tui
+static std::string gen_tui()
+{
+    Corpus c;
+    while (!c.full()) {
+        c.put("\033[?25l\033[H");
+        for (int row = 1; row <= 24; row++) {
+            c.put(fmt::format("\033[{};1H\033[{}m", row,
+                    row == 1 ? 7 : 0));
+            for (int col = 0; col < 60;) {
+                auto w = c.word();
+                c.put(w);
+                c.put(" ");
+                col += w.size() + 1;
+            }
+            c.put("\033[K");
+        }
+
+        // a status line and some scattered cell updates
+        c.put(fmt::format("\033[24;70H\033[44;37m{:>5}\033[0m",
+                c.rand(0, 99999)));
+        for (int i = 0; i < 8; i++)
+            c.put(fmt::format("\033[{};{}H{}", c.rand(2, 23), c.rand(1, 79),
+                    c.word()));
+        c.put("\033[?25h");
+    }
+    return c.take();
+}
+
+// wide chars: cjk ideographs, hangul and emoji
+static std::string gen_wide()
+{
+    Corpus c;
+    while (!c.full()) {
+        for (int col = 0; col < 78; col += 2) {
+            switch (c.rand(0, 2)) {
+                case 0: c.putc(c.rand(0x4e00, 0x9fff)); break;
+                case 1: c.putc(c.rand(0xac00, 0xd7a3)); break;
+                default: c.putc(c.rand(0x1f600, 0x1f64f)); break;
+            }
+        }
+        c.put("\r\n");
+    }
+    return c.take();
+}
+
+// output in a scroll region, with the region changing often,
+// like a pager or a split log view
+static std::string gen_scroll()
+{
+    Corpus c;
+    while (!c.full()) {
+        int top = c.rand(1, 10);
+        int bot = c.rand(top + 2, 24);
+        c.put(fmt::format("\033[{};{}r\033[{};1H", top, bot, bot));
+        for (int i = 0; i < 20; i++) {
+            c.put(c.word());
+            c.put(" ");
+            c.put(c.word());
+            c.put("\r\n");
+        }
+
+        // scroll back down from the top
+        c.put(fmt::format("\033[{};1H", top));
+        for (int i = 0; i < 4; i++)
+            c.put("\033M");
+        c.put(fmt::format("\033[{}S\033[{}T", c.rand(1, 5), c.rand(1, 5)));
+    }
+    c.put("\033[r");
+    return c.take();
+}
+
+// long osc strings, like titles set by a shell prompt and
+// osc 52 clipboard writes
+static std::string gen_osc()
+{
+    Corpus c;
+    while (!c.full()) {
+        c.put("\033]0;");
+        for (int i = c.rand(20, 200); i > 0; i--) {
+            c.put(c.word());
+            c.put(" ");
+        }
+        c.put("\a");
+
+        c.put("\033]52;c;");
+        for (int i = c.rand(500, 4000); i > 0; i--)
+            c.putc("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz"
+                   "0123456789+/"[c.rand(0, 63)]);
+        c.put("\033\\");
+
+        c.put("$ ");
+        c.put(c.word());
+        c.put("\r\n");
+    }
+    return c.take();
+}
+
+void bench_parser(ankerl::nanobench::Config& cfg)
+{
+    const std::array<std::pair<const char*, std::string (*)()>, 6>
+            cases = {{
+                    {"ascii", gen_ascii},
+                    {"sgr", gen_sgr},
+                    {"tui", gen_tui},
+                    {"cjk/emoji", gen_wide},
+                    {"scroll region", gen_scroll},
+                    {"osc", gen_osc},
+            }};
+
+    headless::Headless h{80, 24};
+
+    for (const auto& [name, gen] : cases) {
+        const auto data = gen();
+
+        // start each case from a clean terminal
+        h.feed("\033c");
+        h.present();
+
+        cfg.title("parser")
+                .unit("byte")
+                .batch(data.size())
+                .minEpochIterations(5)
+                .run(name, [&] {
+                    h.feed(data);
+                    h.present();
+                });
+
+        fmt::print("{}: {:.1f} MB/s\n", name, last_mbps(cfg));
+    }
+}
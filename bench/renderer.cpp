@@ -0,0 +1,129 @@
+#include "fmt/format.h"
+#include "lua/config.h"
+#include "nanobench.h"
+#include "rwte/coords.h"
+#include "rwte/headless.h"
+#include "rwte/renderer.h"
+#include "rwte/term.h"
+
+#include <cairo/cairo.h>
+#include <string>
+
+// a screen of colored, attributed text, like a highlighted
+// source listing
+static std::string screen_contents(int cols, int rows)
+{
+    std::string out = "\033[H\033[2J";
+    for (int row = 0; row < rows; row++) {
+        for (int col = 0; col < cols; col++) {
+            if (col % 7 == 0)
+                out += fmt::format("\033[0;{};{}m", 30 + (row + col) % 8,
+                        col % 3 == 0 ? 1 : 22);
+            out += static_cast<char>('!' + (row * cols + col) % 94);
+        }
+        if (row < rows - 1)
+            out += "\r\n";
+    }
+    return out + "\033[0m";
+}
+
+// runs op as a benchmark of glyphs glyphs, and prints the frame
+// time alongside nanobench's per-glyph cost
+template <typename Op>
+static void run_frame(ankerl::nanobench::Config& cfg, const std::string& name,
+        int glyphs, Op&& op)
+{
+    cfg.batch(glyphs).run(name, op);
+
+    const auto& result = cfg.results().back();
+    fmt::print("{}: {:.1f} us/frame\n", name,
+            result.median().count() * glyphs * 1e6);
+}
+
+static void bench_size(ankerl::nanobench::Config& cfg, int cols, int rows)
+{
+    headless::Headless h{cols, rows};
+    auto& term = h.term();
+    h.feed(screen_contents(cols, rows));
+    h.present();
+
+    renderer::Renderer r{&term};
+
+    // size the surface like the windows do
+    auto font_surface = cairo_image_surface_create(
+            CAIRO_FORMAT_ARGB32, 20, 20);
+    r.load_font(font_surface);
+    cairo_surface_destroy(font_surface);
+
+    const int border_px = lua::config::get_int("border_px", 2);
+    const int width = cols * r.charwidth() + 2 * border_px;
+    const int height = rows * r.charheight() + 2 * border_px;
+
+    // renderer takes ownership of the surface
+    r.set_surface(cairo_image_surface_create(
+                          CAIRO_FORMAT_ARGB32, width, height),
+            width, height);
+
+    const auto size = fmt::format("{}x{}", cols, rows);
+    const Cell begin{0, 0};
+    const Cell end{rows, cols};
+
+    cfg.title("renderer").unit("glyph");
+
+    run_frame(cfg, "full repaint " + size, cols * rows, [&] {
+        r.invalidate();
+        term.setdirty();
+        r.drawregion(begin, end);
+    });
+
+    // every row dirty but drawn the same, like a dashboard rewriting
+    // itself each tick
+    run_frame(cfg, "unchanged rewrite " + size, cols * rows, [&] {
+        term.setdirty();
+        r.drawregion(begin, end);
+    });
+
+    // rewrite the middle row, alternating what's on it so it's
+    // drawn each time; only it should be drawn
+    const std::string edits[2] = {
+            fmt::format("\033[{};1H{}", rows / 2 + 1, std::string(cols, 'x')),
+            fmt::format("\033[{};1H{}", rows / 2 + 1, std::string(cols, 'y'))};
+    bool editflip = false;
+    run_frame(cfg, "row edit " + size, cols, [&] {
+        h.feed(edits[editflip = !editflip]);
+        r.drawregion(begin, end);
+    });
+
+    // bounce the cursor between two cells, with nothing dirty
+    bool flip = false;
+    run_frame(cfg, "cursor only " + size, 1, [&] {
+        h.feed((flip = !flip) ? "\033[5;10H" : "\033[6;20H");
+        r.drawregion(begin, end);
+    });
+
+    h.feed("\033[?5h");
+    run_frame(cfg, "reverse video " + size, cols * rows, [&] {
+        r.invalidate();
+        term.setdirty();
+        r.drawregion(begin, end);
+    });
+    h.feed("\033[?5l");
+
+    // drag a selection over most of the screen
+    const term::keymod_state nomod;
+    term.mousereport({1, 4}, term::MOUSE_PRESS, 1, nomod);
+    term.mousereport({rows - 2, cols - 4}, term::MOUSE_MOTION, 0, nomod);
+    term.mousereport({rows - 2, cols - 4}, term::MOUSE_RELEASE, 1, nomod);
+    run_frame(cfg, "selection " + size, cols * rows, [&] {
+        r.invalidate();
+        term.setdirty();
+        r.drawregion(begin, end);
+    });
+    term.selclear();
+}
+
+void bench_renderer(ankerl::nanobench::Config& cfg)
+{
+    bench_size(cfg, 80, 24);
+    bench_size(cfg, 200, 60);
+}
@@ -0,0 +1,124 @@
+#include "fmt/format.h"
+#include "lua/config.h"
+#include "rw/logging.h"
+#include "rwte/coords.h"
+#include "rwte/headless.h"
+#include "rwte/recording.h"
+#include "rwte/renderer.h"
+#include "rwte/term.h"
+
+#include <algorithm>
+#include <cairo/cairo.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LOGGER() (rw::logging::get("rwte-bench"))
+
+using namespace std::chrono;
+
+// matches the renderer's refresh throttle in Rwte
+constexpr microseconds frame_delay{16667};
+
+static double percentile(std::vector<double>& v, double p)
+{
+    if (v.empty())
+        return 0;
+
+    auto n = static_cast<std::size_t>(p * (v.size() - 1));
+    std::nth_element(v.begin(), v.begin() + n, v.end());
+    return v[n];
+}
+
+void bench_replay(const std::string& path, bool realtime)
+{
+    recording::Reader reader{path};
+    if (!reader.ok())
+        LOGGER()->fatal("{} is not a recording", path);
+
+    headless::Headless h{reader.cols(), reader.rows()};
+    auto& term = h.term();
+
+    // frames are drawn by the renderer onto an image surface, sized
+    // like the windows do
+    renderer::Renderer r{&term};
+    auto font_surface = cairo_image_surface_create(
+            CAIRO_FORMAT_ARGB32, 20, 20);
+    r.load_font(font_surface);
+    cairo_surface_destroy(font_surface);
+
+    auto set_surface = [&](int cols, int rows) {
+        const int border_px = lua::config::get_int("border_px", 2);
+        const int width = cols * r.charwidth() + 2 * border_px;
+        const int height = rows * r.charheight() + 2 * border_px;
+
+        // renderer takes ownership of the surface
+        r.set_surface(cairo_image_surface_create(
+                              CAIRO_FORMAT_ARGB32, width, height),
+                width, height);
+    };
+    set_surface(reader.cols(), reader.rows());
+
+    std::size_t bytes = 0;
+    steady_clock::duration parse{};
+    std::vector<double> frame_us;
+
+    // frames are due one throttle interval after the first refresh
+    // request, measured on the recording's clock, or right away when
+    // the term asks to be drawn, as at the end of a synchronized
+    // update
+    bool frame_pending = false;
+    microseconds frame_due{0};
+
+    auto present = [&] {
+        frame_pending = false;
+        if (!h.takeframe())
+            return;
+
+        auto begin = steady_clock::now();
+        r.drawregion({0, 0}, {term.rows(), term.cols()});
+        frame_us.push_back(duration<double, std::micro>(
+                steady_clock::now() - begin)
+                                   .count());
+    };
+
+    const auto start = steady_clock::now();
+    recording::Record rec;
+    while (reader.next(rec)) {
+        if (frame_pending && rec.time >= frame_due)
+            present();
+
+        if (realtime)
+            std::this_thread::sleep_until(start + rec.time);
+
+        if (rec.kind == recording::Record::Kind::Resize) {
+            h.resize(rec.cols, rec.rows);
+            set_surface(rec.cols, rec.rows);
+        } else {
+            auto begin = steady_clock::now();
+            h.feed(rec.data);
+            parse += steady_clock::now() - begin;
+            bytes += rec.data.size();
+        }
+
+        if (h.drawqueued()) {
+            present();
+        } else if (!frame_pending && h.refreshqueued()) {
+            frame_pending = true;
+            frame_due = rec.time + frame_delay;
+        }
+    }
+
+    if (frame_pending)
+        present();
+
+    const double secs = duration<double>(parse).count();
+    fmt::print("{}: {} bytes, parse {:.3f} ms, {:.1f} MB/s\n",
+            path, bytes, secs * 1e3, secs > 0 ? bytes / secs / 1e6 : 0.0);
+    fmt::print("{}: {} frames, draw us p50 {:.1f} p90 {:.1f} "
+               "p99 {:.1f} max {:.1f}\n",
+            path, frame_us.size(),
+            percentile(frame_us, 0.5), percentile(frame_us, 0.9),
+            percentile(frame_us, 0.99), percentile(frame_us, 1.0));
+}
@@ -0,0 +1,123 @@
+#include "fmt/format.h"
+#include "nanobench.h"
+#include "rw/logging.h"
+#include "rwte/screen.h"
+#include "rwte/selection.h"
+
+#include <array>
+#include <functional>
+#include <string>
+
+#define LOGGER() (rw::logging::get("rwte-bench"))
+
+// todo: better way than extern.
+std::size_t alloc_count();
+
+struct ScreenSize
+{
+    int cols, rows;
+};
+
+constexpr std::array<ScreenSize, 3> screen_sizes = {{
+        {80, 24},
+        {200, 60},
+        {400, 120},
+}};
+
+// a screen full of varied glyphs, at the given size
+static void fill_screen(screen::Screen& scr, int cols, int rows)
+{
+    scr.resize(cols, rows);
+    scr.setscroll(0, rows - 1);
+
+    Cell cell;
+    for (cell.row = 0; cell.row < rows; cell.row++) {
+        for (cell.col = 0; cell.col < cols; cell.col++) {
+            screen::Glyph g{};
+            g.u = 'a' + (cell.row + cell.col) % 26;
+            g.fg = cell.col % 16;
+            g.bg = cell.row % 8;
+            scr.setGlyph(cell, g);
+        }
+    }
+}
+
+// runs op as a benchmark, then checks that more runs of it do
+// not allocate
+static void run_op(ankerl::nanobench::Config& cfg, const std::string& name,
+        const std::function<void()>& op)
+{
+    cfg.run(name, op);
+
+    auto before = alloc_count();
+    for (int i = 0; i < 100; i++)
+        op();
+    if (auto allocs = alloc_count() - before)
+        LOGGER()->warn("{}: {} allocations per 100 ops", name, allocs);
+}
+
+void bench_screen(ankerl::nanobench::Config& cfg)
+{
+    cfg.title("screen").unit("op").batch(1);
+
+    auto bus = std::make_shared<event::Bus>();
+    screen::Screen scr{bus};
+
+    for (const auto [cols, rows] : screen_sizes) {
+        fill_screen(scr, cols, rows);
+        const auto size = fmt::format("{}x{}", cols, rows);
+
+        // a region in the middle half, like a pager's body
+        const int top = rows / 4;
+        const int bot = rows * 3 / 4;
+
+        scr.setscroll(0, rows - 1);
+        run_op(cfg, "scrollup " + size, [&] { scr.scrollup(0, 1); });
+        run_op(cfg, "scrolldown " + size, [&] { scr.scrolldown(0, 1); });
+
+        scr.setscroll(top, bot);
+        run_op(cfg, "scrollup region " + size,
+                [&] { scr.scrollup(top, 1); });
+        run_op(cfg, "scrolldown region " + size,
+                [&] { scr.scrolldown(top, 1); });
+        scr.setscroll(0, rows - 1);
+
+        screen::Cursor cursor = scr.cursor();
+        cursor.row = rows / 2;
+        cursor.col = 4;
+        scr.setCursor(cursor);
+        run_op(cfg, "insertblank " + size, [&] { scr.insertblank(8); });
+        run_op(cfg, "deletechar " + size, [&] { scr.deletechar(8); });
+
+        run_op(cfg, "clear row " + size, [&] {
+            scr.clear({rows / 2, 0}, {rows / 2, cols - 1});
+        });
+        run_op(cfg, "clear " + size, [&] { scr.clear(); });
+
+        // double clicking a word that wraps across the whole screen
+        fill_screen(scr, cols, rows);
+        for (int row = 0; row < rows - 1; row++) {
+            screen::Glyph g{};
+            g.u = 'z';
+            g.attr.wrap = 1;
+            scr.setGlyph({row, cols - 1}, g);
+        }
+        scr.sel().snap = Selection::Snap::Word;
+        run_op(cfg, "snap word " + size, [&] {
+            Cell b{rows / 2, cols / 2};
+            Cell e = b;
+            scr.selsnap(&b.col, &b.row, -1);
+            scr.selsnap(&e.col, &e.row, +1);
+        });
+        scr.sel().snap = Selection::Snap::None;
+
+        // resizing back and forth, like a tiling window manager; the
+        // reflow builds new rows, so it allocates by design
+        fill_screen(scr, cols, rows);
+        bool narrow = false;
+        cfg.run("reflow " + size, [&] {
+            narrow = !narrow;
+            scr.resize(narrow ? cols - 7 : cols, rows);
+        });
+    }
+}
@@ -0,0 +1,51 @@
+#include "fmt/format.h"
+#include "nanobench.h"
+#include "rw/logging.h"
+#include "rwte/headless.h"
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define LOGGER() (rw::logging::get("rwte-bench"))
+
+static std::string read_file(const std::string& path)
+{
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+        LOGGER()->fatal("could not open {}", path);
+
+    return {std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>()};
+}
+
+// median throughput of the last run, in MB/s
+double last_mbps(const ankerl::nanobench::Config& cfg)
+{
+    const auto& result = cfg.results().back();
+    return 1.0 / result.median().count() / 1e6;
+}
+
+void bench_term_files(ankerl::nanobench::Config& cfg,
+        const std::vector<std::string>& paths)
+{
+    // each file is a raw byte stream, as read from a pty
+    for (const auto& path : paths) {
+        const auto data = read_file(path);
+        if (data.empty())
+            continue;
+
+        headless::Headless h{80, 24};
+
+        cfg.title("term feed")
+                .unit("byte")
+                .batch(data.size())
+                .run(path, [&] {
+                    h.feed(data);
+                    h.present();
+                });
+
+        fmt::print("{}: {:.1f} MB/s\n", path, last_mbps(cfg));
+    }
+}
@@ -69,6 +69,7 @@ public:
     float tonumber(int index);
     float tonumberx(int index, int* isnum);
     float tonumberdef(int index, float def);
+    void pushnumber(double n);
 
     bool tobool(int index);
     bool tobooldef(int index, bool def);
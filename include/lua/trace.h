@@ -0,0 +1,14 @@
+#ifndef LUA_TRACE_H
+#define LUA_TRACE_H
+
+// lua trace integration
+
+namespace lua {
+
+class State;
+
+void register_luatrace(State* L);
+
+} // namespace lua
+
+#endif // LUA_TRACE_H
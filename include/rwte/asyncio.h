@@ -5,6 +5,8 @@
 #include "rwte/reactorctrl.h"
 
 #include <array>
+#include <cstdint>
+#include <string_view>
 #include <unistd.h>
 #include <vector>
 
@@ -47,7 +49,7 @@ public:
         }
 
         // if nothing's pending for write, kick it off
-        if (m_wbuffer.empty()) {
+        if (m_wbuffer.empty() && !lowmidchar()) {
             ssize_t written = ::write(m_fd, pdata, std::min(len, max_write));
             // todo: error handling
             // todo: consider throwing
@@ -66,11 +68,56 @@ public:
 
         // copy anything left into m_wbuffer
         std::copy_n(pdata, len, std::back_inserter(m_wbuffer));
+        static_cast<T*>(this)->log_buffered(m_wbuffer.size());
 
         // now we want write events too
         m_ctrl->set_write(m_fd, true);
     }
 
+    // queues data to be written once nothing from write is waiting,
+    // so it never holds up more urgent writes. it's only interrupted
+    // between utf8 characters.
+    void writelow(std::string_view data)
+    {
+        if (data.empty())
+            return;
+
+        // drop what's been written, rather than moving it on each write
+        if (m_lpos > 0) {
+            m_lbuffer.erase(m_lbuffer.begin(), m_lbuffer.begin() + m_lpos);
+            m_lpos = 0;
+        }
+
+        m_lbuffer.insert(m_lbuffer.end(), data.begin(), data.end());
+        m_lqueued += data.size();
+
+        m_ctrl->set_write(m_fd, true);
+    }
+
+    // low priority bytes queued but not yet written
+    std::size_t lowpending() const { return m_lbuffer.size() - m_lpos; }
+
+    // total low priority bytes ever queued; a position in the queue
+    uint64_t lowqueued() const { return m_lqueued; }
+
+    // drops low priority bytes queued from position at (see lowqueued)
+    // on, except for the rest of a partly written character
+    void droplow(uint64_t at)
+    {
+        const uint64_t written = m_lqueued - lowpending();
+        std::size_t keep = at > written ? at - written : 0;
+        if (keep == 0) {
+            while (keep < lowpending() &&
+                    (m_lbuffer[m_lpos + keep] & 0xC0) == 0x80)
+                keep++;
+        }
+
+        if (keep < lowpending()) {
+            m_lqueued -= lowpending() - keep;
+            m_lbuffer.resize(m_lpos + keep);
+        }
+    }
+
     void read_ready()
     {
         char* ptr = &m_rbuffer[0];
@@ -78,6 +125,7 @@ public:
         // append read bytes to unprocessed bytes
         int ret;
         if ((ret = ::read(m_fd, ptr + m_rbuflen, m_rbuffer.size() - m_rbuflen)) > 0) {
+            static_cast<T*>(this)->log_read(ptr + m_rbuflen, ret);
             m_rbuflen += ret;
 
             m_rbuflen = static_cast<T*>(this)->onread(ptr, m_rbuflen);
@@ -106,19 +154,26 @@ public:
 
     void write_ready()
     {
-        auto remaining = m_wbuffer.size();
-        int written = ::write(m_fd, m_wbuffer.data(), std::min(remaining, max_write));
+        // low priority data goes once nothing else is waiting, or when
+        // it's partway through a character
+        const bool low = m_wbuffer.empty() || lowmidchar();
+        const char* data = low ? m_lbuffer.data() + m_lpos : m_wbuffer.data();
+        auto remaining = low ? lowpending() : m_wbuffer.size();
+
+        int written = ::write(m_fd, data, std::min(remaining, max_write));
         if (written > 0) {
-            static_cast<T*>(this)->log_write(false, m_wbuffer.data(), written);
+            static_cast<T*>(this)->log_write(false, data, written);
             remaining -= written;
 
-            // anything left to write?
-            if (!remaining) {
-                // nope.
+            if (low) {
+                m_lpos += written;
+                if (!remaining) {
+                    m_lbuffer.resize(0);
+                    m_lpos = 0;
+                }
+                static_cast<T*>(this)->log_low(remaining);
+            } else if (!remaining) {
                 m_wbuffer.resize(0);
-
-                // stop waiting for write events
-                m_ctrl->set_write(m_fd, false);
             } else {
                 // if anything's left, move it up front, and shrink
                 //todo: remove
@@ -126,6 +181,12 @@ public:
                         m_wbuffer.begin());
                 m_wbuffer.resize(remaining);
             }
+
+            // anything left to write?
+            if (m_wbuffer.empty() && !lowpending()) {
+                // nope. stop waiting for write events
+                m_ctrl->set_write(m_fd, false);
+            }
         } else if (written == 0) {
             // this is fine, not really an error. probably means we did
             // something odd, like a zero byte write, or that we're listening
@@ -141,6 +202,13 @@ public:
     }
 
 private:
+    // whether low priority data stopped partway through a utf8
+    // character, so nothing else can be written until it's finished
+    bool lowmidchar() const
+    {
+        return lowpending() && (m_lbuffer[m_lpos] & 0xC0) == 0x80;
+    }
+
     reactor::ReactorCtrl *m_ctrl;
 
     int m_fd;
@@ -152,6 +220,11 @@ private:
 
     // write buffer
     std::vector<char> m_wbuffer;
+
+    // low priority write buffer, written from m_lpos
+    std::vector<char> m_lbuffer;
+    std::size_t m_lpos = 0;
+    uint64_t m_lqueued = 0;
 };
 
 // undefine LOGGER, restoring if needed
@@ -0,0 +1,145 @@
+#ifndef RWTE_ASYNCLOG_H
+#define RWTE_ASYNCLOG_H
+
+#include "fmt/format.h"
+#include "rw/logging.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Asynchronous logging for hot paths. Records are formatted on the
+// calling thread, queued in a bounded lock-free ring, and handed to
+// their logger by a background writer, so the caller never waits
+// on log io. When the ring is full, records are dropped and counted
+// rather than blocking. Until start is called (and after stop),
+// records are written synchronously, as are fatal records.
+//
+// Records written through a logger directly aren't queued, so they
+// may appear ahead of queued records logged before them.
+//
+// Levels below RWTE_LOG_LEVEL (0 for trace through 5 for fatal, set
+// by the log_level meson option) are compiled out of the level
+// helpers, so nothing is formatted or queued for them. Their
+// arguments, like the logger, are still evaluated at the call; wrap
+// costly ones in lazy to skip that too.
+#ifndef RWTE_LOG_LEVEL
+#define RWTE_LOG_LEVEL 0
+#endif
+
+namespace asynclog {
+
+constexpr auto compiled_level =
+        static_cast<rw::logging::log_level>(RWTE_LOG_LEVEL);
+
+// an argument that is only evaluated if the record is logged
+template <typename F>
+struct Lazy
+{
+    F f;
+};
+
+template <typename F>
+Lazy<F> lazy(F&& f)
+{
+    return {std::forward<F>(f)};
+}
+
+// starts the background writer
+void start();
+
+// drains the ring and stops the background writer
+void stop();
+
+// records dropped because the ring was full
+uint64_t dropped();
+
+// whether a record at level would be written by logger
+inline bool enabled(const std::shared_ptr<rw::logging::Logger>& logger,
+        rw::logging::log_level level)
+{
+    return compiled_level <= level && logger->level() <= level;
+}
+
+// queues a preformatted record for logger
+void write(const std::shared_ptr<rw::logging::Logger>& logger,
+        rw::logging::log_level level, std::string msg);
+
+// queues a trace record of raw terminal bytes, like an escape
+// sequence; only the bytes are copied here, and the writer escapes
+// them for display. label must be a literal.
+void sequence(const std::shared_ptr<rw::logging::Logger>& logger,
+        const char* label, std::string_view bytes);
+
+// renders raw terminal bytes printably, with control chars escaped
+std::string escape(std::string_view bytes);
+
+template <typename... Args>
+void log(const std::shared_ptr<rw::logging::Logger>& logger,
+        rw::logging::log_level level, std::string_view format,
+        const Args&... args)
+{
+    if (!enabled(logger, level))
+        return;
+
+    write(logger, level,
+            fmt::vformat(format, fmt::make_format_args(args...)));
+}
+
+template <typename... Args>
+void trace(const std::shared_ptr<rw::logging::Logger>& logger,
+        std::string_view format, const Args&... args)
+{
+    if constexpr (compiled_level <= rw::logging::log_level::trace)
+        log(logger, rw::logging::log_level::trace, format, args...);
+}
+
+template <typename... Args>
+void debug(const std::shared_ptr<rw::logging::Logger>& logger,
+        std::string_view format, const Args&... args)
+{
+    if constexpr (compiled_level <= rw::logging::log_level::debug)
+        log(logger, rw::logging::log_level::debug, format, args...);
+}
+
+template <typename... Args>
+void info(const std::shared_ptr<rw::logging::Logger>& logger,
+        std::string_view format, const Args&... args)
+{
+    if constexpr (compiled_level <= rw::logging::log_level::info)
+        log(logger, rw::logging::log_level::info, format, args...);
+}
+
+template <typename... Args>
+void warn(const std::shared_ptr<rw::logging::Logger>& logger,
+        std::string_view format, const Args&... args)
+{
+    if constexpr (compiled_level <= rw::logging::log_level::warn)
+        log(logger, rw::logging::log_level::warn, format, args...);
+}
+
+template <typename... Args>
+void error(const std::shared_ptr<rw::logging::Logger>& logger,
+        std::string_view format, const Args&... args)
+{
+    if constexpr (compiled_level <= rw::logging::log_level::err)
+        log(logger, rw::logging::log_level::err, format, args...);
+}
+
+} // namespace asynclog
+
+template <typename F>
+struct fmt::formatter<asynclog::Lazy<F>>
+{
+    constexpr auto parse(format_parse_context& ctx) { return ctx.begin(); }
+
+    template <typename FormatContext>
+    auto format(const asynclog::Lazy<F>& arg, FormatContext& ctx) const
+    {
+        return fmt::format_to(ctx.out(), "{}", arg.f());
+    }
+};
+
+#endif // RWTE_ASYNCLOG_H
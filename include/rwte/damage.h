@@ -0,0 +1,63 @@
+#ifndef RWTE_DAMAGE_H
+#define RWTE_DAMAGE_H
+
+#include <cstddef>
+#include <vector>
+
+namespace renderer {
+
+// a rectangle of pixels
+struct Rect
+{
+    int x, y;
+    int width, height;
+
+    bool empty() const { return width <= 0 || height <= 0; }
+    long area() const { return empty() ? 0 : long(width) * height; }
+};
+
+inline bool operator==(const Rect& a, const Rect& b)
+{
+    return a.x == b.x && a.y == b.y && a.width == b.width &&
+           a.height == b.height;
+}
+
+inline bool operator!=(const Rect& a, const Rect& b)
+{
+    return !(a == b);
+}
+
+// smallest rect holding both a and b
+Rect unite(const Rect& a, const Rect& b);
+
+// The parts of a surface painted by a frame, kept as a few rects for
+// the window to hand on to its compositor or server. Rects are merged
+// as they're added when that costs nothing, like cells painted next to
+// each other on a row, or rows painted one under another; past
+// max_rects, the two rects whose union adds the least are merged, so
+// the list never grows past the bound, at the cost of some pixels
+// counted as damaged that weren't.
+class Damage
+{
+public:
+    static constexpr std::size_t max_rects = 8;
+
+    void add(const Rect& r);
+    void clear() { m_rects.clear(); }
+
+    bool empty() const { return m_rects.empty(); }
+    const std::vector<Rect>& rects() const { return m_rects; }
+
+    // smallest rect holding all the damage
+    Rect bounds() const;
+
+private:
+    // adds r, first taking in any rects it joins without waste
+    void insert(Rect r);
+
+    std::vector<Rect> m_rects;
+};
+
+} // namespace renderer
+
+#endif // RWTE_DAMAGE_H
@@ -14,9 +14,20 @@ struct Resize
 struct Refresh
 {};
 
+// the tty has written enough of a paste to take more, or has
+// cancelled it
+struct PasteReady
+{};
+
+// lines have scrolled into the history
+struct HistoryPush
+{};
+
 typedef Bus<
         Resize,
-        Refresh>
+        Refresh,
+        PasteReady,
+        HistoryPush>
         Bus;
 
 } // namespace event
@@ -0,0 +1,73 @@
+#ifndef RWTE_HEADLESS_H
+#define RWTE_HEADLESS_H
+
+#include "rwte/event.h"
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace reactor {
+class ReactorCtrl;
+} // namespace reactor
+namespace term {
+class Term;
+} // namespace term
+
+namespace headless {
+
+class HeadlessImpl;
+
+// Runs a Term with no window, tty or reactor, for benchmarks and
+// replay. Installs the rwte global along with a stub config, so
+// only one may exist at a time, and not alongside a real Rwte.
+class Headless
+{
+public:
+    Headless(int cols, int rows);
+    // with timers and refreshes going to ctrl, like a reactor, for
+    // driving the term through a real Tty; refreshqueued and present
+    // don't see those refreshes
+    Headless(int cols, int rows, reactor::ReactorCtrl* ctrl);
+    ~Headless();
+
+    // decodes data and feeds it to the terminal; any incomplete
+    // utf8 sequence at the end is held for the next call
+    void feed(std::string_view data);
+
+    // resizes as if the window had changed size
+    void resize(int cols, int rows);
+
+    // whether the terminal has asked for a refresh since the
+    // last frame
+    bool refreshqueued() const;
+
+    // whether the terminal has asked to be drawn right away since the
+    // last frame, as it does at the end of a synchronized update
+    bool drawqueued() const;
+
+    // if the terminal asked for a refresh or a draw, clears the
+    // request, counts a frame and returns true; for drawing the
+    // frame with a renderer of one's own
+    bool takeframe();
+
+    // stands in for the renderer: takes a frame, if one was asked
+    // for, and consumes the dirty rows
+    bool present();
+
+    // number of frames taken
+    std::size_t frames() const;
+
+    term::Term& term();
+
+    // for wiring up a Tty or Window of one's own
+    std::shared_ptr<term::Term> termptr();
+    std::shared_ptr<event::Bus> bus();
+
+private:
+    std::unique_ptr<HeadlessImpl> impl;
+};
+
+} // namespace headless
+
+#endif // RWTE_HEADLESS_H
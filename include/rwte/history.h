@@ -0,0 +1,73 @@
+#ifndef RWTE_HISTORY_H
+#define RWTE_HISTORY_H
+
+#include "rwte/screen.h"
+
+#include <cstddef>
+#include <memory>
+
+namespace screen {
+
+class HistoryImpl;
+
+// Lines scrolled off the top of the main screen, oldest first. The
+// newest lines are kept in memory as they were. With spilling on,
+// older lines are packed (attribute runs, with blank runs collapsed)
+// into fixed size blocks in an anonymous file, and mapped back in a
+// block at a time when read, so memory use stays flat however long
+// the history grows. Safe to read from other threads while the
+// screen pushes lines.
+class History
+{
+public:
+    struct Options
+    {
+        // most lines kept; 0 disables history
+        std::size_t max_lines = 0;
+        // whether lines past ram_lines are spilled to disk
+        bool spill = false;
+        // lines kept in memory when spilling
+        std::size_t ram_lines = 1000;
+    };
+
+    History();
+    ~History();
+
+    // drops all lines, then applies opts
+    void configure(const Options& opts);
+
+    void push(const screenRow& row);
+    // takes the newest line back off, returning false if empty. its
+    // number is reused by the next push.
+    bool pop(screenRow& row);
+    void clear();
+
+    // number of lines held
+    std::size_t size() const;
+
+    // line i, where 0 is the oldest line held
+    screenRow line(std::size_t i) const;
+
+    // lines are also numbered from the first ever pushed; these
+    // numbers don't shift as old lines are dropped. first is the
+    // oldest line held, and total is one past the newest.
+    std::size_t first() const;
+    std::size_t total() const;
+
+    // reads line n (by number, as above) into row, returning false
+    // if it has been dropped or not yet pushed
+    bool lineat(std::size_t n, screenRow& row) const;
+
+    // approximate memory used, not counting spilled lines
+    std::size_t memsize() const;
+
+    // bytes of spilled blocks in the backing file
+    std::size_t spillsize() const;
+
+private:
+    std::unique_ptr<HistoryImpl> impl;
+};
+
+} // namespace screen
+
+#endif // RWTE_HISTORY_H
@@ -0,0 +1,88 @@
+#ifndef RWTE_PERF_H
+#define RWTE_PERF_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Lightweight counters for the performance hud and runtime stats,
+// bumped by the tty, term, rwte and renderer as they work. Rates are
+// computed over one second windows, which close as frames are drawn;
+// stats are cumulative.
+namespace perf {
+
+using clock = std::chrono::steady_clock;
+
+// kinds of sequence handled by the term
+enum class Seq
+{
+    Control,
+    Esc,
+    Csi,
+    Str, // osc, dcs, apc, pm
+    Count
+};
+
+struct Stats
+{
+    uint64_t pty_read = 0;
+    uint64_t pty_written = 0;
+    std::array<uint64_t, static_cast<int>(Seq::Count)> seqs = {};
+    uint64_t frames = 0;
+    uint64_t frames_held = 0; // refreshes held by synchronized updates
+    clock::duration parse{};
+    clock::duration render{};
+    clock::duration lua{};
+    std::size_t peak_write_buffer = 0;
+};
+
+struct Rates
+{
+    double fps = 0;           // frames drawn per second
+    double flushes = 0;       // frames requested by the refresh timer
+    double frame_ms = 0;      // render time per frame
+    double pty_bytes = 0;     // bytes read from the pty per second
+    double parse_ms = 0;      // parse time per frame
+    double dirty_rows = 0;    // rows drawn per frame
+    uint64_t cache_hits = 0;  // glyph cache lookups
+    uint64_t cache_misses = 0;
+};
+
+// bytes read from the pty
+void pty_read(std::size_t bytes);
+// time spent handing read bytes to the term
+void parsed(clock::duration time);
+// a frame requested by the refresh timer
+void flushed();
+// a frame drawn, and how many rows it drew
+void drawn(clock::duration time, int dirty_rows);
+// a glyph cache lookup
+void cache(bool hit);
+// bytes written to the pty
+void pty_written(std::size_t bytes);
+// bytes waiting to be written to the pty
+void write_buffered(std::size_t bytes);
+// a sequence handled by the term
+void seq(Seq kind);
+// a refresh held while a synchronized update is active
+void held();
+// time spent in lua callbacks
+void luacall(clock::duration time);
+
+// rates for the last complete window
+const Rates& rates();
+
+// totals since startup
+const Stats& stats();
+
+// logs the totals, along with the memory used by the screen
+void log_stats(std::size_t screen_bytes);
+
+// whether the hud should be drawn
+bool hud();
+void set_hud(bool enable);
+
+} // namespace perf
+
+#endif // RWTE_PERF_H
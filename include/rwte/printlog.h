@@ -0,0 +1,67 @@
+#ifndef RWTE_PRINTLOG_H
+#define RWTE_PRINTLOG_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Output for printed chars (MODE_PRINT, and -o). Printing appends to
+// a staging buffer on the term's thread; staged output is handed to
+// a background thread that does the writes, so the term only pays
+// for a copy. Optionally rotates the file by size.
+namespace printlog {
+
+struct Options
+{
+    // rotate once this many bytes are written; 0 to never rotate
+    std::size_t rotate_bytes = 0;
+    // rotated files to keep, as path.1, path.2, ...
+    int keep = 1;
+    // most output waiting on, or being written by, the writer
+    // before print blocks
+    std::size_t max_pending = 4 << 20;
+};
+
+class Writer
+{
+public:
+    // writes to an already open fd and takes ownership of it; path
+    // is what gets rotated, and may be empty to disable rotation
+    Writer(int fd, std::string path, const Options& opts);
+    // writes anything still buffered
+    ~Writer();
+
+    void print(std::string_view data);
+
+    // hands staged output to the writer; called after each read, so
+    // output reaches the file in read sized chunks
+    void flush();
+
+private:
+    void run();
+    void write_out(const std::string& buf);
+    void rotate();
+
+    int m_fd;
+    std::string m_path;
+    Options m_opts;
+    std::size_t m_written = 0;
+
+    std::string m_staging; // term thread only
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;    // output is pending, or stopping
+    std::condition_variable m_drained; // the writer took the pending output
+    std::string m_pending;
+    std::size_t m_inflight = 0; // taken by the writer, not yet written
+    bool m_stopping = false;
+
+    std::thread m_thread;
+};
+
+} // namespace printlog
+
+#endif // RWTE_PRINTLOG_H
@@ -37,8 +37,14 @@ struct RepeatKey
 {};
 struct Blink
 {};
+struct SyncTimeout
+{};
 struct ChildEnd
 {};
+struct TraceToggle
+{};
+struct StatsDump
+{};
 struct Stop
 {};
 
@@ -49,7 +55,10 @@ using Event = std::variant<
         Refresh,
         RepeatKey,
         Blink,
+        SyncTimeout,
         ChildEnd,
+        TraceToggle,
+        StatsDump,
         Stop>;
 
 class Reactor : public ReactorCtrl
@@ -69,6 +78,8 @@ public:
     void stop_repeat();
     void start_blink(float secs);
     void stop_blink();
+    void start_sync(float secs);
+    void stop_sync();
 
     Event wait();
 
@@ -84,6 +95,7 @@ private:
     int m_refreshfd = -1;
     int m_repeatfd = -1;
     int m_blinkfd = -1;
+    int m_syncfd = -1;
     int m_ttyfd = -1;
     int m_windowfd = -1;
 
@@ -16,6 +16,8 @@ public:
     virtual void stop_repeat() = 0;
     virtual void start_blink(float secs) = 0;
     virtual void stop_blink() = 0;
+    virtual void start_sync(float secs) = 0;
+    virtual void stop_sync() = 0;
 };
 
 } // namespace reactor
@@ -0,0 +1,88 @@
+#ifndef RWTE_RECORDING_H
+#define RWTE_RECORDING_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Timestamped captures of pty output, for replaying real sessions
+// as benchmarks. The format is a magic/version header followed by
+// records, all integers being LEB128 varints:
+//
+//   header: "RWTEREC" 0x01, cols, rows
+//   record: usecs since previous record, tag, payload
+//
+// where tag is (len << 1) for len bytes of pty output, or 1 for a
+// resize, followed by cols and rows.
+namespace recording {
+
+class Writer
+{
+public:
+    // writes to an already open fd; takes ownership of it
+    Writer(int fd, int cols, int rows);
+    ~Writer();
+
+    void data(std::string_view data);
+    void resize(int cols, int rows);
+
+    bool ok() const { return m_fd != -1; }
+
+private:
+    void put(uint64_t v);
+    void record(uint64_t tag);
+    void flush();
+
+    int m_fd;
+    std::string m_buf;
+    std::chrono::steady_clock::time_point m_last;
+};
+
+struct Record
+{
+    enum class Kind
+    {
+        Data,
+        Resize
+    };
+
+    Kind kind;
+    std::chrono::microseconds time; // since start of recording
+    std::string_view data;
+    int cols, rows;
+};
+
+// whether the file at path starts with a recording header; reads
+// only the header, unlike Reader
+bool isrecording(const std::string& path);
+
+class Reader
+{
+public:
+    // loads the whole file; check ok() before use
+    explicit Reader(const std::string& path);
+
+    bool ok() const { return m_ok; }
+    int cols() const { return m_cols; }
+    int rows() const { return m_rows; }
+
+    // reads the next record, returning false at end
+    bool next(Record& rec);
+
+    // back to first record
+    void rewind();
+
+private:
+    bool get(uint64_t* v);
+
+    std::string m_file;
+    std::size_t m_start = 0, m_pos = 0;
+    std::chrono::microseconds m_time{0};
+    int m_cols = 0, m_rows = 0;
+    bool m_ok = false;
+};
+
+} // namespace recording
+
+#endif // RWTE_RECORDING_H
@@ -0,0 +1,31 @@
+#ifndef RWTE_REFLOW_H
+#define RWTE_REFLOW_H
+
+#include "rwte/coords.h"
+#include "rwte/screen.h"
+
+#include <vector>
+
+namespace screen {
+
+// Rewrapping rows to a new width. A row whose last glyph is marked
+// wrap continues on the next row; each run of rows joined that way is
+// one line, laid out again at the new width with its trailing blanks
+// dropped. Wide glyphs are never split across rows.
+//
+// points are cells in src (row being an index into src) to be kept
+// track of, like the cursor; a line is kept long enough to hold any
+// of its points, even past its content.
+
+// number of rows src takes when laid out cols wide
+int reflowrows(const std::vector<const screenRow*>& src, int cols,
+        const std::vector<Cell>& points);
+
+// lays src out cols wide, filling the rest of each row with blank,
+// and moves points to where their cells landed
+screenRows reflow(const std::vector<const screenRow*>& src, int cols,
+        const Glyph& blank, std::vector<Cell>& points);
+
+} // namespace screen
+
+#endif // RWTE_REFLOW_H
@@ -1,7 +1,10 @@
 #ifndef RWTE_RENDERER_H
 #define RWTE_RENDERER_H
 
+#include "rwte/damage.h"
+
 #include <memory>
+#include <vector>
 
 namespace term {
 class Term;
@@ -34,8 +37,14 @@ public:
     int charwidth() const;
     int charheight() const;
 
-    // note: excludes end
-    void drawregion(const Cell& begin, const Cell& end);
+    // note: excludes end. returns the rects of the surface painted
+    // since the last call, valid until the next one
+    const std::vector<Rect>& drawregion(const Cell& begin, const Cell& end);
+
+    // forgets what was drawn, so rows are drawn when next dirty even
+    // if their glyphs haven't changed; for when the surface's pixels
+    // were lost, like on expose
+    void invalidate();
 
     Cell pxtocell(int x, int y) const;
 
@@ -30,6 +30,7 @@ struct Options
     std::string io;
     std::string line;
     bool noalt = false;
+    bool record = false;
     bool throttledraw = true;
 
 #if defined(BUILD_WAYLAND_OPTIONAL)
@@ -53,10 +54,16 @@ public:
     void start_blink();
     void stop_blink();
 
+    // synchronized updates (DEC private mode 2026); while active,
+    // refreshes are held and presented as one frame at the end
+    void start_sync();
+    void end_sync();
+
     void child_ended();
 
     void flushcb();
     void blinkcb();
+    void synccb();
 
     std::shared_ptr<lua::State> lua() { return m_lua; }
 
@@ -73,6 +80,9 @@ private:
     std::shared_ptr<lua::State> m_lua;
     std::weak_ptr<Window> m_window;
     std::weak_ptr<term::Term> m_term;
+
+    bool m_syncing = false;      // in a synchronized update
+    bool m_sync_pending = false; // refresh held during update
 };
 
 // todo: refactor
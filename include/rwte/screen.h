@@ -11,6 +11,8 @@ class Selection;
 
 namespace screen {
 
+class SelectionText;
+
 struct glyph_attribute
 {
     uint16_t bold : 1;
@@ -92,8 +94,107 @@ struct Cursor : public Cell
 };
 
 using screenRow = std::vector<Glyph>;
-using screenRows = std::vector<screenRow>;
 
+// table of ref-counted rows. rows may be shared with outstanding
+// ScreenView snapshots; any mutable access to a shared row clones
+// it first, so a snapshot never sees later writes.
+class screenRows
+{
+public:
+    using rowPtr = std::shared_ptr<screenRow>;
+
+    template <typename Rows, typename Row>
+    class basic_iterator
+    {
+    public:
+        basic_iterator(Rows* rows, std::size_t idx) :
+            m_rows(rows), m_idx(idx) {}
+
+        Row& operator*() const { return (*m_rows)[m_idx]; }
+        Row* operator->() const { return &(*m_rows)[m_idx]; }
+
+        basic_iterator& operator++()
+        {
+            ++m_idx;
+            return *this;
+        }
+
+        bool operator==(const basic_iterator& other) const
+        {
+            return m_idx == other.m_idx;
+        }
+
+        bool operator!=(const basic_iterator& other) const
+        {
+            return m_idx != other.m_idx;
+        }
+
+    private:
+        Rows* m_rows;
+        std::size_t m_idx;
+    };
+
+    using iterator = basic_iterator<screenRows, screenRow>;
+    using const_iterator = basic_iterator<const screenRows, const screenRow>;
+
+    std::size_t size() const { return m_rows.size(); }
+    bool empty() const { return m_rows.empty(); }
+
+    // new rows are empty; callers size them
+    void resize(std::size_t n);
+    // drops n rows from the top
+    void erase_front(std::size_t n);
+
+    // mutable access detaches the row from any snapshot
+    screenRow& operator[](std::size_t i);
+    const screenRow& operator[](std::size_t i) const { return *m_rows[i]; }
+
+    // swaps row pointers without touching (or cloning) row contents
+    void swap_rows(std::size_t a, std::size_t b)
+    {
+        std::swap(m_rows[a], m_rows[b]);
+    }
+
+    const rowPtr& ptr(std::size_t i) const { return m_rows[i]; }
+
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, m_rows.size()}; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, m_rows.size()}; }
+
+private:
+    std::vector<rowPtr> m_rows;
+};
+
+// read-only snapshot of the visible screen. unchanged rows are shared
+// with the live screen, so taking one only copies the row table.
+class ScreenView
+{
+public:
+    ScreenView() = default;
+
+    int rows() const { return m_lines.size(); }
+    int cols() const { return m_cols; }
+
+    const screenRow& line(int row) const { return *m_lines[row]; }
+    const Glyph& glyph(const Cell& cell) const
+    {
+        return (*m_lines[cell.row])[cell.col];
+    }
+
+    const Cursor& cursor() const { return m_cursor; }
+    cursor_type cursortype() const { return m_cursortype; }
+
+private:
+    friend class ScreenImpl;
+
+    std::vector<std::shared_ptr<const screenRow>> m_lines;
+    int m_cols = 0;
+    Cursor m_cursor;
+    cursor_type m_cursortype = cursor_type::CURSOR_STEADY_BLOCK;
+};
+
+class History;
 class ScreenImpl;
 
 class Screen
@@ -104,7 +205,8 @@ public:
 
     void reset();
 
-    void resize(int cols, int rows);
+    // resizes, reflowing the main screen; new cells are set to blank
+    void resize(int cols, int rows, const Glyph& blank = {});
 
     void swapscreen();
 
@@ -135,10 +237,25 @@ public:
     void selclear();
     void selscroll(int orig, int n);
     void selnormalize();
-    std::shared_ptr<char> getsel() const;
+    // call after changing the selection other than through the
+    // functions above, to update its spans and dirty what changed
+    void selupdate();
+    std::shared_ptr<const SelectionText> getsel() const;
 
     int linelen(int row) const;
 
+    // number of blinking glyphs on the screen, or in one row
+    int blinkcount() const;
+    int blinkcount(int row) const;
+
+    // approximate heap and object size of both screens, in bytes
+    std::size_t memsize() const;
+
+    // lines scrolled off the top of the main screen
+    History& history();
+    const History& history() const;
+    void clearhistory();
+
     bool isdirty(int row) const;
     void setdirty();
     void setdirty(int top, int bot);
@@ -150,6 +267,9 @@ public:
     screenRow& line(int row);
     const screenRow& line(int row) const;
 
+    // O(rows) copy-on-write snapshot of the current screen
+    ScreenView snapshot() const;
+
     const int rows() const;
     const int cols() const;
     const int top() const;
@@ -0,0 +1,70 @@
+#ifndef RWTE_SEARCH_H
+#define RWTE_SEARCH_H
+
+#include "rwte/screen.h"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace screen {
+class History;
+} // namespace screen
+
+namespace search {
+
+// a match, by history line number (see History::first); visible
+// screen row r is line history.total() + r
+struct Match
+{
+    std::size_t line;
+    int col;
+    int len; // in cells
+};
+
+// finds pattern in a row, appending matches for line to out.
+// matching is literal, and ignores ascii case when pattern has no
+// uppercase letters.
+void findrow(const screen::screenRow& row, const std::string& pattern,
+        std::size_t line, std::vector<Match>& out);
+
+class SearchImpl;
+
+// Literal search of the history. Once started, a background thread
+// scans the history, then sleeps until told of lines pushed since,
+// so the caller only ever looks up what has already been found.
+// The visible screen changes too often to index; callers search it
+// directly with findrow.
+class Search
+{
+public:
+    explicit Search(const screen::History& history);
+    ~Search();
+
+    // starts searching for pattern, dropping earlier matches; an
+    // empty pattern stops searching
+    void start(std::string pattern);
+
+    // lines have been pushed to the history; wakes the scan to
+    // search them. cheap when no search is active.
+    void pushed();
+
+    const std::string& pattern() const;
+    bool active() const { return !pattern().empty(); }
+
+    // history matches found so far
+    std::size_t count() const;
+
+    // the nearest history match before (dir < 0) or after (dir > 0)
+    // the given position
+    std::optional<Match> find(std::size_t line, int col, int dir) const;
+
+private:
+    std::unique_ptr<SearchImpl> impl;
+};
+
+} // namespace search
+
+#endif // RWTE_SEARCH_H
@@ -5,6 +5,11 @@
 
 #include <chrono>
 #include <memory>
+#include <vector>
+
+namespace screen {
+class SelectionText;
+} // namespace screen
 
 class Selection
 {
@@ -23,12 +28,33 @@ public:
         Line = 2
     };
 
+    // columns [begin, end) of a row that are selected
+    struct Span
+    {
+        int begin = 0;
+        int end = 0;
+
+        bool empty() const { return begin >= end; }
+        bool contains(int col) const { return begin <= col && col < end; }
+        bool operator==(const Span& other) const
+        {
+            return begin == other.begin && end == other.end;
+        }
+        bool operator!=(const Span& other) const { return !(*this == other); }
+    };
+
     void clear();
     void begin(const Cell& cell);
     bool empty() const;
     bool anyselected(const Cell& begin, const Cell& end) const;
     bool selected(const Cell& cell) const;
 
+    // recomputes each row's span from nb and ne, for a screen of the
+    // given size, appending the rows whose span changed to changed
+    void updatespans(int rows, int cols, std::vector<int>& changed);
+    // a row's span, as of the last update
+    const Span& span(int row) const;
+
     void setmode(Mode val) { m_mode = val; }
     Mode mode() const { return m_mode; }
 
@@ -47,16 +73,21 @@ public:
     Cell ob{0, -1};
     Cell oe{0, 0};
 
-    std::shared_ptr<char> primary;
-    std::shared_ptr<char> clipboard;
+    // selected text, for pasting elsewhere
+    std::shared_ptr<const screen::SelectionText> primary;
+    std::shared_ptr<const screen::SelectionText> clipboard;
 
     bool alt = false;
     std::chrono::time_point<std::chrono::steady_clock> tclick1 = {};
     std::chrono::time_point<std::chrono::steady_clock> tclick2 = {};
 
 private:
+    // the span of row, computed from nb and ne
+    Span rowspan(int row, int cols) const;
+
     Mode m_mode = Mode::Idle;
     bool m_rectangular = false;
+    std::vector<Span> m_spans; // per row
 };
 
 #endif // RWTE_SELECTION_H
@@ -0,0 +1,61 @@
+#ifndef RWTE_SELTEXT_H
+#define RWTE_SELTEXT_H
+
+#include "rwte/coords.h"
+#include "rwte/screen.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace screen {
+
+// The text of a selection, produced a piece at a time, so a large
+// selection is never held as one string. It keeps the rows it was
+// made from, shared copy-on-write with the screen like a ScreenView,
+// so the text doesn't change as the screen does. Each copy has its
+// own read position.
+class SelectionText
+{
+public:
+    // rows[i] is screen row nb.row + i
+    SelectionText(std::vector<std::shared_ptr<const screenRow>> rows,
+            int cols, const Cell& nb, const Cell& ne, bool rectangular);
+
+    // appends up to max bytes of utf8 to out (more only if max can't
+    // hold a single character), returning false once the text is
+    // all read
+    bool read(std::string& out, std::size_t max);
+
+    // starts reading from the beginning again
+    void rewind();
+
+    // the whole text at once; only for selections known to be small
+    std::string str() const;
+
+private:
+    // what is taken from a row: glyphs [first, last], then maybe \n
+    struct Range
+    {
+        int first;
+        int last;
+        bool newline;
+    };
+
+    Range range(std::size_t i) const;
+
+    std::shared_ptr<const std::vector<std::shared_ptr<const screenRow>>> m_rows;
+    int m_cols;
+    Cell m_nb;
+    Cell m_ne;
+    bool m_rectangular;
+
+    // read position; m_col is -1 until the row is started
+    std::size_t m_row = 0;
+    int m_col = -1;
+};
+
+} // namespace screen
+
+#endif // RWTE_SELTEXT_H
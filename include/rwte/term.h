@@ -5,6 +5,8 @@
 
 #include <bitset>
 #include <memory>
+#include <string>
+#include <string_view>
 
 struct Cell;
 class Selection;
@@ -12,7 +14,11 @@ namespace screen {
 struct Cursor;
 enum class cursor_type;
 struct Glyph;
+class ScreenView;
 } // namespace screen
+namespace search {
+struct Match;
+} // namespace search
 class Tty;
 class Window;
 
@@ -61,7 +67,8 @@ enum term_mode_enum
     MODE_PRINT,
     MODE_UTF8,
     MODE_SIXEL,
-    MODE_LAST = MODE_SIXEL
+    MODE_SYNC,
+    MODE_LAST = MODE_SYNC
 };
 
 using term_mode = std::bitset<MODE_LAST + 1>;
@@ -92,14 +99,34 @@ public:
 
     void blink();
 
+    // ends a synchronized update, if one is active
+    void endsync();
+
     const Selection& sel() const;
     const screen::Cursor& cursor() const;
     screen::cursor_type cursortype() const;
+    screen::ScreenView snapshot() const;
 
     bool isdirty(int row) const;
     void setdirty();
     void cleardirty(int row);
 
+    // approximate memory used by the screens, in bytes
+    std::size_t memsize() const;
+
+    // starts searching the screen and history for pattern; empty
+    // ends the search
+    void search(std::string_view pattern);
+    // moves to the next match up (dir < 0) or down (dir > 0) from
+    // the current one, returning false if there isn't one
+    bool searchstep(int dir, search::Match& match);
+    // the current match, if there is one
+    bool searchcurrent(search::Match& match) const;
+    // pattern being searched for; empty if not searching
+    const std::string& searchpattern() const;
+    // line number of visible row 0, in search::Match terms
+    std::size_t searchbase() const;
+
     void putc(char32_t u);
     void mousereport(const Cell& cell, mouse_event_enum evt, int button,
             const keymod_state& mod);
@@ -120,6 +147,7 @@ public:
     void clipcopy();
 
     void send(std::string_view data);
+    void pastecancel();
 
 private:
     std::unique_ptr<TermImpl> impl;
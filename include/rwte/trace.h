@@ -0,0 +1,77 @@
+#ifndef RWTE_TRACE_H
+#define RWTE_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Scoped trace spans, kept in per-thread ring buffers and dumped as
+// Chrome trace event json (which Perfetto also loads). While tracing
+// is stopped, a span costs one well predicted branch, so spans stay
+// compiled in.
+namespace trace {
+
+namespace detail {
+
+extern std::atomic<bool> active;
+
+inline uint64_t now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+void record(const char* name, uint64_t start, uint64_t end);
+
+} // namespace detail
+
+inline bool enabled()
+{
+    return __builtin_expect(
+            detail::active.load(std::memory_order_relaxed), false);
+}
+
+// records the time between construction and destruction; name
+// must outlive the trace, so should be a literal
+class Span
+{
+public:
+    explicit Span(const char* name) : m_name(name)
+    {
+        if (enabled())
+            m_start = detail::now();
+    }
+
+    ~Span()
+    {
+        if (m_start)
+            detail::record(m_name, m_start, detail::now());
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start = 0;
+};
+
+void start();
+void stop();
+
+// writes everything in the buffers to path, returning false on error
+bool dump(const std::string& path);
+
+// where dumps go when no path is given
+std::string default_path();
+
+} // namespace trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) \
+    trace::Span TRACE_CONCAT(trace_span_, __LINE__) { name }
+
+#endif // RWTE_TRACE_H
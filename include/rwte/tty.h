@@ -3,6 +3,7 @@
 
 #include "rwte/event.h"
 
+#include <cstddef>
 #include <memory>
 #include <string_view>
 
@@ -30,6 +31,22 @@ public:
 
     void write(std::string_view data);
 
+    // pasted data is written after anything from write, so typing
+    // isn't held up by a large paste, with \n sent as \r and wrapped
+    // in bracketed paste markers if the term wants them. within
+    // markers, writes are held until the close marker is written,
+    // so the app doesn't take them as pasted. only about
+    // pasteroom bytes should be given to paste at a time; PasteReady
+    // is published when there's room for more.
+    void pastebegin();
+    void paste(std::string_view data);
+    void pasteend();
+    // drops what's left of the paste, and ends it. if it hadn't
+    // ended, PasteReady is published, with pasting now false
+    void pastecancel();
+    bool pasting() const;
+    std::size_t pasteroom() const;
+
     void print(std::string_view data);
 
     void hup();
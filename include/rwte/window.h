@@ -5,6 +5,7 @@
 #include "rwte/event.h"
 
 #include <memory>
+#include <stdexcept>
 #include <string>
 
 namespace reactor {
@@ -0,0 +1,43 @@
+#ifndef RWTE_WORDCLASS_H
+#define RWTE_WORDCLASS_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace screen {
+
+// The word delimiters from config, looked up when snapping a selection
+// to words. Built once from the utf8 string of delimiters: the basic
+// multilingual plane is a bitmap, anything above it a sorted table of
+// ranges, so each lookup is cheap.
+class WordClass
+{
+public:
+    // no delimiters; a word is the whole line
+    WordClass();
+    explicit WordClass(std::string_view delimiters);
+
+    bool isdelim(char32_t c) const
+    {
+        if (c < bmp_size)
+            return (m_bmp[c / 64] >> (c % 64)) & 1;
+        return !m_ranges.empty() && isdelimabove(c);
+    }
+
+private:
+    static constexpr char32_t bmp_size = 0x10000;
+
+    bool isdelimabove(char32_t c) const;
+
+    std::array<uint64_t, bmp_size / 64> m_bmp;
+
+    // inclusive [first, last] ranges above the bmp
+    std::vector<std::pair<char32_t, char32_t>> m_ranges;
+};
+
+} // namespace screen
+
+#endif // RWTE_WORDCLASS_H
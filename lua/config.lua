@@ -131,6 +131,19 @@ config = {
 
     -- whether alt screens are used
     allow_alt_screen = true,
+    -- the alternate screen is only allocated while it's used; once
+    -- hidden and blank for this many seconds, it's released
+    alt_screen_keep = 30,
+
+    -- lines scrolled off the top are kept as history, up to
+    -- scrollback_lines (0 keeps none). there's no view to scroll it
+    -- yet; it's what reflow pulls lines back from on resize, and
+    -- what search looks through. with scrollback_spill, only the
+    -- newest scrollback_ram_lines stay in memory; older lines are
+    -- compressed into an anonymous temp file
+    scrollback_lines = 0,
+    scrollback_spill = false,
+    scrollback_ram_lines = 1000,
 
     -- cursor. choices for type are "blink block", "steady block",
     -- "blink under", "steady under", "blink bar", and "steady bar",
@@ -139,7 +152,19 @@ config = {
     cursor_thickness = 2,
 
     -- rate at which text / the cursor blinks, in seconds
-    blink_rate = 0.6
+    blink_rate = 0.6,
+
+    -- longest a synchronized update (mode 2026) may hold back
+    -- drawing before it's ended for the app, in seconds
+    sync_timeout = 0.5,
+
+    -- printed output (-o) is rotated to out.1, out.2, ... after
+    -- this many KiB, keeping io_rotate_keep files; 0 never rotates
+    io_rotate_kb = 0,
+    io_rotate_keep = 1,
+    -- most printed output that may wait on the disk, in KiB,
+    -- before printing waits for it
+    io_buffer_kb = 4096
 }
 
 window.mouse_press(function(col, row, button, mod)
@@ -338,6 +363,12 @@ window.key_press(function(sym, mod)
         elseif sym == window.keys.Y then
             window.selpaste()
             return true
+        elseif sym == window.keys.X then
+            term.pastecancel()
+            return true
+        elseif sym == window.keys.H then
+            window.perf_hud()
+            return true
         end
     end
 
@@ -0,0 +1,265 @@
+#include "rw/logging.h"
+#include "rwte/asynclog.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#define LOGGER() (rw::logging::get("asynclog"))
+
+namespace asynclog {
+
+namespace {
+
+struct Record
+{
+    std::shared_ptr<rw::logging::Logger> logger;
+    rw::logging::log_level level;
+    std::string msg;      // or raw bytes, if there's a label
+    const char* label = nullptr;
+};
+
+// sequence records are escaped here, on the writer
+void emit(const Record& rec)
+{
+    if (rec.label) {
+        auto msg = fmt::format("{} {}", rec.label, escape(rec.msg));
+        rec.logger->log(rec.level, msg.c_str());
+    } else
+        rec.logger->log(rec.level, rec.msg.c_str());
+}
+
+// bounded multi producer ring (after Vyukov's bounded queue); each
+// slot's sequence says whether it's free for the producer claiming
+// it or full for the consumer. only the writer thread pops.
+class Ring
+{
+public:
+    static constexpr std::size_t capacity = 1 << 12;
+
+    Ring()
+    {
+        for (std::size_t i = 0; i < capacity; i++)
+            m_slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(Record&& rec)
+    {
+        auto pos = m_tail.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& slot = m_slots[pos & mask];
+            auto seq = slot.seq.load(std::memory_order_acquire);
+            auto diff = static_cast<intptr_t>(seq) -
+                        static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1,
+                            std::memory_order_relaxed)) {
+                    slot.rec = std::move(rec);
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(Record& rec)
+    {
+        auto& slot = m_slots[m_head & mask];
+        if (slot.seq.load(std::memory_order_acquire) != m_head + 1)
+            return false; // empty, or a push in progress
+
+        rec = std::move(slot.rec);
+        slot.seq.store(m_head + capacity, std::memory_order_release);
+        m_head++;
+        return true;
+    }
+
+    // whether pop would fail; seq_cst, so a producer that pushed and
+    // then found the writer not sleeping is seen here
+    bool empty() const
+    {
+        const auto& slot = m_slots[m_head & mask];
+        return slot.seq.load() != m_head + 1;
+    }
+
+private:
+    static constexpr std::size_t mask = capacity - 1;
+
+    struct Slot
+    {
+        std::atomic<std::size_t> seq;
+        Record rec;
+    };
+
+    std::array<Slot, capacity> m_slots;
+    alignas(64) std::atomic<std::size_t> m_tail{0};
+    alignas(64) std::size_t m_head = 0;
+};
+
+std::atomic<bool> running{false};
+std::atomic<uint64_t> drops{0};
+
+struct Writer
+{
+    Ring ring;
+
+    // the writer sleeps on wake when the ring is empty; producers
+    // only touch it to wake a sleeping writer. the writer sets
+    // sleeping before its last look at the ring, and producers look
+    // at sleeping after pushing, so one of them sees the other.
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> sleeping{false};
+
+    // set once the thread has drained the ring and exited
+    std::condition_variable done;
+    bool finished = false;
+};
+
+// never freed, and the thread is detached, so a fatal exit with the
+// writer still running doesn't tear either down under it
+Writer* writer = nullptr;
+
+void drain()
+{
+    Record rec;
+    while (writer->ring.pop(rec)) {
+        emit(rec);
+        rec.logger.reset();
+    }
+}
+
+void run()
+{
+    while (running.load(std::memory_order_acquire)) {
+        drain();
+
+        std::unique_lock lock{writer->mutex};
+        writer->sleeping.store(true);
+        writer->wake.wait(lock, [] {
+            return !running.load() || !writer->ring.empty();
+        });
+        writer->sleeping.store(false);
+    }
+
+    drain();
+
+    std::lock_guard lock{writer->mutex};
+    writer->finished = true;
+    writer->done.notify_all();
+}
+
+} // namespace
+
+void start()
+{
+    if (running.load())
+        return;
+
+    if (!writer)
+        writer = new Writer;
+
+    {
+        // a push that raced the last stop checks these together
+        std::lock_guard lock{writer->mutex};
+        writer->finished = false;
+        running.store(true, std::memory_order_release);
+    }
+    std::thread{run}.detach();
+}
+
+void stop()
+{
+    if (!running.exchange(false))
+        return;
+
+    std::unique_lock lock{writer->mutex};
+    writer->wake.notify_one();
+    writer->done.wait(lock, [] { return writer->finished; });
+    lock.unlock();
+
+    if (auto n = drops.load())
+        LOGGER()->warn("dropped {} log records", n);
+}
+
+uint64_t dropped()
+{
+    return drops.load(std::memory_order_relaxed);
+}
+
+std::string escape(std::string_view bytes)
+{
+    fmt::memory_buffer msg;
+
+    for (unsigned char c : bytes) {
+        if (isprint(c))
+            msg.push_back(static_cast<char>(c));
+        else if (c == '\n')
+            fmt::format_to(msg, "(\\n)");
+        else if (c == '\r')
+            fmt::format_to(msg, "(\\r)");
+        else if (c == 0x1b)
+            fmt::format_to(msg, "(\\e)");
+        else
+            fmt::format_to(msg, "(0x{:02X})", c);
+    }
+
+    return fmt::to_string(msg);
+}
+
+static void push(Record&& rec)
+{
+    // fatal records may not return, so they can't wait in the ring
+    if (!running.load(std::memory_order_acquire) ||
+            rec.level >= rw::logging::log_level::fatal) {
+        emit(rec);
+        return;
+    }
+
+    if (!writer->ring.push(std::move(rec))) {
+        drops.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // stopped since the check above; the writer's last drain may
+    // have missed the record, so once it's done, write it here
+    if (!running.load()) {
+        std::unique_lock lock{writer->mutex};
+        writer->done.wait(lock, [] {
+            return writer->finished || running.load();
+        });
+        if (!running.load())
+            drain();
+        return;
+    }
+
+    if (writer->sleeping.load()) {
+        std::lock_guard lock{writer->mutex};
+        writer->wake.notify_one();
+    }
+}
+
+void write(const std::shared_ptr<rw::logging::Logger>& logger,
+        rw::logging::log_level level, std::string msg)
+{
+    push({logger, level, std::move(msg)});
+}
+
+void sequence(const std::shared_ptr<rw::logging::Logger>& logger,
+        const char* label, std::string_view bytes)
+{
+    if (!enabled(logger, rw::logging::log_level::trace))
+        return;
+
+    push({logger, rw::logging::log_level::trace, std::string{bytes}, label});
+}
+
+} // namespace asynclog
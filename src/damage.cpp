@@ -0,0 +1,101 @@
+#include "rwte/damage.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace renderer {
+
+Rect unite(const Rect& a, const Rect& b)
+{
+    if (a.empty())
+        return b;
+    if (b.empty())
+        return a;
+
+    const int x = std::min(a.x, b.x);
+    const int y = std::min(a.y, b.y);
+    return {x, y,
+            std::max(a.x + a.width, b.x + b.width) - x,
+            std::max(a.y + a.height, b.y + b.height) - y};
+}
+
+static bool contains(const Rect& a, const Rect& b)
+{
+    return a.x <= b.x && a.y <= b.y &&
+           b.x + b.width <= a.x + a.width &&
+           b.y + b.height <= a.y + a.height;
+}
+
+// whether the union of a and b covers nothing but a and b
+static bool joins(const Rect& a, const Rect& b)
+{
+    if (contains(a, b) || contains(b, a))
+        return true;
+
+    // side by side, the same height
+    if (a.y == b.y && a.height == b.height)
+        return b.x <= a.x + a.width && a.x <= b.x + b.width;
+
+    // one over the other, the same width
+    if (a.x == b.x && a.width == b.width)
+        return b.y <= a.y + a.height && a.y <= b.y + b.height;
+
+    return false;
+}
+
+void Damage::add(const Rect& r)
+{
+    if (r.empty())
+        return;
+
+    insert(r);
+    if (m_rects.size() <= max_rects)
+        return;
+
+    // too many; merge the pair that wastes the least
+    std::size_t bi = 0, bj = 1;
+    long best = std::numeric_limits<long>::max();
+    for (std::size_t i = 0; i < m_rects.size(); i++) {
+        for (std::size_t j = i + 1; j < m_rects.size(); j++) {
+            const auto& a = m_rects[i];
+            const auto& b = m_rects[j];
+            const long waste = unite(a, b).area() - a.area() - b.area();
+            if (waste < best) {
+                best = waste;
+                bi = i;
+                bj = j;
+            }
+        }
+    }
+
+    const auto u = unite(m_rects[bi], m_rects[bj]);
+    m_rects.erase(m_rects.begin() + bj);
+    m_rects.erase(m_rects.begin() + bi);
+    insert(u);
+}
+
+Rect Damage::bounds() const
+{
+    Rect b{0, 0, 0, 0};
+    for (const auto& r : m_rects)
+        b = unite(b, r);
+    return b;
+}
+
+void Damage::insert(Rect r)
+{
+    // each rect taken in grows r, which may let it join another
+    for (auto it = m_rects.begin(); it != m_rects.end();) {
+        if (joins(*it, r)) {
+            r = unite(*it, r);
+            m_rects.erase(it);
+            it = m_rects.begin();
+        } else {
+            ++it;
+        }
+    }
+
+    m_rects.push_back(r);
+}
+
+} // namespace renderer
@@ -0,0 +1,285 @@
+#include "lua/state.h"
+#include "rw/logging.h"
+#include "rw/utf8.h"
+#include "rwte/headless.h"
+#include "rwte/reactorctrl.h"
+#include "rwte/rwte.h"
+#include "rwte/screen.h"
+#include "rwte/term.h"
+#include "rwte/window.h"
+
+#include <array>
+#include <string>
+
+#define LOGGER() (rw::logging::get("headless"))
+
+namespace headless {
+
+// stands in for the reactor; timers never fire, and refresh
+// requests are only noted, for present to pick up
+class NullCtrl : public reactor::ReactorCtrl
+{
+public:
+    void set_write(int fd, bool write) {}
+    void unreg(int fd) {}
+
+    void queue_refresh(float secs) { refresh_queued = true; }
+    void start_repeat(float secs) {}
+    void stop_repeat() {}
+    void start_blink(float secs) {}
+    void stop_blink() {}
+    void start_sync(float secs) {}
+    void stop_sync() {}
+
+    bool refresh_queued = false;
+};
+
+// stands in for the window; Rwte draws it straight away, rather than
+// queueing a refresh, at the end of a synchronized update, and when
+// refreshes aren't throttled
+class NullWindow : public Window
+{
+public:
+#if !defined(BUILD_WAYLAND_ONLY)
+    uint32_t windowid() const { return 0; }
+#endif
+
+    int fd() const { return -1; }
+    void prepare() {}
+    bool event() { return false; }
+    bool check() { return false; }
+
+    void draw() { draw_queued = true; }
+
+    void settitle(std::string_view name) {}
+    void seturgent(bool urgent) {}
+    void bell(int volume) {}
+
+    void setsel() {}
+    void selpaste() {}
+    void setclip() {}
+    void clippaste() {}
+
+    bool draw_queued = false;
+};
+
+// xterm's default 16 colors, plus black at 255
+constexpr std::array<uint32_t, 16> stub_colors = {
+        0x000000, 0xcd0000, 0x00cd00, 0xcdcd00,
+        0x0000ee, 0xcd00cd, 0x00cdcd, 0xe5e5e5,
+        0x7f7f7f, 0xff0000, 0x00ff00, 0xffff00,
+        0x5c5cff, 0xff00ff, 0x00ffff, 0xffffff};
+
+// just enough config for Term, Screen, Renderer and Tty
+static void stub_config(lua::State* L)
+{
+    L->newtable();
+
+    L->newtable();
+    for (std::size_t i = 0; i < stub_colors.size(); i++) {
+        L->pushinteger(stub_colors[i] | 1 << 24);
+        L->seti(-2, i);
+    }
+    L->pushinteger(1 << 24);
+    L->seti(-2, 255);
+    L->setfield(-2, "colors");
+    L->pushinteger(255);
+    L->setfield(-2, "black_idx");
+
+    L->pushstring("monospace 10");
+    L->setfield(-2, "font");
+    L->pushinteger(2);
+    L->setfield(-2, "border_px");
+    L->pushinteger(2);
+    L->setfield(-2, "cursor_thickness");
+
+    L->pushinteger(7);
+    L->setfield(-2, "default_fg");
+    L->pushinteger(0);
+    L->setfield(-2, "default_bg");
+    L->pushinteger(7);
+    L->setfield(-2, "default_cs");
+    L->pushinteger(0);
+    L->setfield(-2, "default_rcs");
+    L->pushinteger(8);
+    L->setfield(-2, "tab_spaces");
+    L->pushstring("steady block");
+    L->setfield(-2, "cursor_type");
+    L->pushstring(" ");
+    L->setfield(-2, "word_delimiters");
+    L->pushstring("st-256color");
+    L->setfield(-2, "term_name");
+
+    L->setglobal("config");
+}
+
+class HeadlessImpl
+{
+public:
+    HeadlessImpl(int cols, int rows, reactor::ReactorCtrl* ctrl);
+    ~HeadlessImpl();
+
+    void feed(std::string_view data);
+    void resize(int cols, int rows);
+    bool present();
+
+    bool refreshqueued() const { return m_ctrl.refresh_queued; }
+    bool drawqueued() const { return m_window->draw_queued; }
+    bool takeframe();
+
+    std::size_t frames() const { return m_frames; }
+
+    term::Term& term() { return *m_term; }
+    std::shared_ptr<term::Term> termptr() { return m_term; }
+    std::shared_ptr<event::Bus> bus() { return m_bus; }
+
+private:
+    std::shared_ptr<event::Bus> m_bus;
+    NullCtrl m_ctrl;
+    std::shared_ptr<NullWindow> m_window;
+    std::shared_ptr<term::Term> m_term;
+
+    std::string m_partial; // incomplete utf8 from last feed
+    std::size_t m_frames = 0;
+};
+
+HeadlessImpl::HeadlessImpl(int cols, int rows, reactor::ReactorCtrl* ctrl) :
+    m_bus(std::make_shared<event::Bus>()),
+    m_window(std::make_shared<NullWindow>())
+{
+    if (rwte)
+        LOGGER()->fatal("headless term needs the rwte global to itself");
+
+    rwte = std::make_unique<Rwte>(m_bus, ctrl ? ctrl : &m_ctrl);
+    stub_config(rwte->lua().get());
+
+    m_term = std::make_shared<term::Term>(m_bus, cols, rows);
+    rwte->setTerm(m_term);
+    rwte->setWindow(m_window);
+}
+
+HeadlessImpl::~HeadlessImpl()
+{
+    m_term.reset();
+    rwte.reset();
+}
+
+void HeadlessImpl::feed(std::string_view data)
+{
+    // finish any char split across feeds first
+    if (!m_partial.empty()) {
+        m_partial.append(data);
+        data = m_partial;
+    }
+
+    // same decoding as TtyImpl::onread
+    while (!data.empty()) {
+        if (m_term->mode()[term::MODE_UTF8] &&
+                !m_term->mode()[term::MODE_SIXEL]) {
+            auto [sz, cp] = utf8decode(data);
+            if (sz == 0)
+                break; // incomplete char
+
+            m_term->putc(cp);
+            data = data.substr(sz);
+        } else {
+            m_term->putc(data.front() & 0xFF);
+            data = data.substr(1);
+        }
+    }
+
+    m_partial = std::string{data};
+}
+
+void HeadlessImpl::resize(int cols, int rows)
+{
+    m_bus->publish(event::Resize{0, 0, cols, rows});
+}
+
+bool HeadlessImpl::takeframe()
+{
+    if (!m_ctrl.refresh_queued && !m_window->draw_queued)
+        return false;
+    m_ctrl.refresh_queued = false;
+    m_window->draw_queued = false;
+
+    m_frames++;
+    return true;
+}
+
+bool HeadlessImpl::present()
+{
+    if (!takeframe())
+        return false;
+
+    // read what the renderer would, then mark it drawn
+    const auto view = m_term->snapshot();
+    for (int row = 0; row < view.rows(); row++) {
+        if (m_term->isdirty(row))
+            m_term->cleardirty(row);
+    }
+
+    return true;
+}
+
+Headless::Headless(int cols, int rows) :
+    impl(std::make_unique<HeadlessImpl>(cols, rows, nullptr))
+{}
+
+Headless::Headless(int cols, int rows, reactor::ReactorCtrl* ctrl) :
+    impl(std::make_unique<HeadlessImpl>(cols, rows, ctrl))
+{}
+
+Headless::~Headless() = default;
+
+void Headless::feed(std::string_view data)
+{
+    impl->feed(data);
+}
+
+void Headless::resize(int cols, int rows)
+{
+    impl->resize(cols, rows);
+}
+
+bool Headless::refreshqueued() const
+{
+    return impl->refreshqueued();
+}
+
+bool Headless::drawqueued() const
+{
+    return impl->drawqueued();
+}
+
+bool Headless::takeframe()
+{
+    return impl->takeframe();
+}
+
+bool Headless::present()
+{
+    return impl->present();
+}
+
+std::size_t Headless::frames() const
+{
+    return impl->frames();
+}
+
+term::Term& Headless::term()
+{
+    return impl->term();
+}
+
+std::shared_ptr<term::Term> Headless::termptr()
+{
+    return impl->termptr();
+}
+
+std::shared_ptr<event::Bus> Headless::bus()
+{
+    return impl->bus();
+}
+
+} // namespace headless
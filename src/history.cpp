@@ -0,0 +1,594 @@
+#include "rw/logging.h"
+#include "rwte/history.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define LOGGER() (rw::logging::get("history"))
+
+namespace screen {
+
+// spilled lines are packed into blocks of this size; a line never
+// spans blocks
+constexpr std::size_t block_size = 64 * 1024;
+
+static uint16_t packattr(const glyph_attribute& attr)
+{
+    uint16_t v;
+    static_assert(sizeof(attr) == sizeof(v));
+    std::memcpy(&v, &attr, sizeof(v));
+    return v;
+}
+
+static glyph_attribute unpackattr(uint16_t v)
+{
+    glyph_attribute attr;
+    std::memcpy(&attr, &v, sizeof(v));
+    return attr;
+}
+
+static void put(std::string& out, uint64_t v)
+{
+    do {
+        uint8_t b = v & 0x7f;
+        v >>= 7;
+        if (v)
+            b |= 0x80;
+        out.push_back(static_cast<char>(b));
+    } while (v);
+}
+
+static uint64_t get(const char*& p)
+{
+    uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t b = *p++;
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+}
+
+// a line is its width, then runs of glyphs sharing attributes and
+// colors: (len << 1 | blank), attr, fg, bg, then len chars unless
+// the run is all spaces
+static void encode(const screenRow& row, std::string& out)
+{
+    put(out, row.size());
+
+    auto same = [](const Glyph& a, const Glyph& b) {
+        return a.attr == b.attr && a.fg == b.fg && a.bg == b.bg;
+    };
+
+    for (auto it = row.begin(); it != row.end();) {
+        auto end = std::find_if_not(it + 1, row.end(),
+                [&](const Glyph& g) { return same(g, *it); });
+
+        bool blank = std::all_of(it, end,
+                [](const Glyph& g) { return g.u == empty_char; });
+
+        put(out, static_cast<uint64_t>(end - it) << 1 | blank);
+        put(out, packattr(it->attr));
+        put(out, it->fg);
+        put(out, it->bg);
+        if (!blank) {
+            for (auto g = it; g != end; ++g)
+                put(out, g->u);
+        }
+
+        it = end;
+    }
+}
+
+static void decode(const char*& p, screenRow& row)
+{
+    row.resize(get(p));
+
+    for (std::size_t col = 0; col < row.size();) {
+        auto tag = get(p);
+        auto len = std::min<std::size_t>(tag >> 1, row.size() - col);
+        bool blank = tag & 1;
+
+        Glyph g;
+        g.attr = unpackattr(get(p));
+        g.fg = get(p);
+        g.bg = get(p);
+        for (std::size_t i = 0; i < len; i++, col++) {
+            if (!blank)
+                g.u = get(p);
+            row[col] = g;
+        }
+    }
+}
+
+// steps past one encoded line
+static void skip(const char*& p)
+{
+    auto cols = get(p);
+    for (std::size_t col = 0; col < cols;) {
+        auto tag = get(p);
+        get(p);
+        get(p);
+        get(p);
+        if (!(tag & 1)) {
+            for (std::size_t i = 0; i < (tag >> 1); i++)
+                get(p);
+        }
+        col += tag >> 1;
+    }
+}
+
+static int open_spill()
+{
+    int fd = memfd_create("rwte-history", MFD_CLOEXEC);
+    if (fd != -1)
+        return fd;
+
+    // no memfd; fall back to an unlinked temp file
+    const char* tmpdir = std::getenv("TMPDIR");
+    std::string path = tmpdir ? tmpdir : "/tmp";
+    path += "/rwte-history-XXXXXX";
+    fd = mkostemp(path.data(), O_CLOEXEC);
+    if (fd != -1)
+        unlink(path.c_str());
+    return fd;
+}
+
+class HistoryImpl
+{
+public:
+    ~HistoryImpl() { close_spill(); }
+
+    void configure(const History::Options& opts)
+    {
+        std::lock_guard lock{m_mutex};
+        close_spill();
+        clearlines();
+
+        m_opts = opts;
+        m_ring_cap = m_opts.max_lines;
+        if (m_opts.spill && m_opts.max_lines > m_opts.ram_lines) {
+            m_ring_cap = m_opts.ram_lines;
+            m_fd = open_spill();
+            if (m_fd == -1)
+                LOGGER()->error("unable to open history spill file: {}",
+                        strerror(errno));
+        }
+    }
+
+    void push(const screenRow& row);
+    bool pop(screenRow& row);
+
+    void clear()
+    {
+        std::lock_guard lock{m_mutex};
+        clearlines();
+    }
+
+    std::size_t size() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_total - m_dropped;
+    }
+
+    std::size_t first() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_dropped;
+    }
+
+    std::size_t total() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_total;
+    }
+
+    bool lineat(std::size_t n, screenRow& row) const;
+
+    std::size_t memsize() const
+    {
+        std::lock_guard lock{m_mutex};
+        std::size_t size = sizeof(*this) + m_staging.capacity() +
+                           m_blocks.size() * sizeof(Block);
+        for (auto& row : m_ring)
+            size += sizeof(row) + row.capacity() * sizeof(Glyph);
+        return size;
+    }
+
+    std::size_t spillsize() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_blocks.size() * block_size;
+    }
+
+private:
+    struct Block
+    {
+        std::size_t first; // line number of first line
+        std::size_t lines;
+        off_t offset;
+    };
+
+    void clearlines()
+    {
+        m_ring.clear();
+        m_ring_head = 0;
+        m_ring_size = 0;
+        m_blocks.clear();
+        m_staging.clear();
+        m_staging_lines = 0;
+        // numbering carries on, so numbers are never reused
+        m_dropped = m_total;
+        m_next_offset = 0;
+
+        unmap();
+        if (m_fd != -1 && ftruncate(m_fd, 0) == -1)
+            LOGGER()->warn("unable to truncate history: {}", strerror(errno));
+    }
+
+    bool spilling() const { return m_fd != -1; }
+
+    // line number of the first line not yet sealed in a block
+    std::size_t staging_first() const
+    {
+        return m_blocks.empty() ? m_dropped
+                                : m_blocks.back().first + m_blocks.back().lines;
+    }
+
+    void spill(const screenRow& row);
+    void seal();
+    bool unseal();
+    void trim();
+    const char* map(const Block& block) const;
+    void unmap() const;
+    void close_spill();
+
+    History::Options m_opts;
+
+    // newest lines, oldest at m_ring_head
+    std::vector<screenRow> m_ring;
+    std::size_t m_ring_cap = 0;
+    std::size_t m_ring_head = 0;
+    std::size_t m_ring_size = 0;
+
+    // spilled lines: sealed blocks, oldest first, then the block
+    // being filled
+    int m_fd = -1;
+    std::deque<Block> m_blocks;
+    std::string m_staging;
+    std::size_t m_staging_lines = 0;
+    off_t m_next_offset = 0;
+    std::string m_enc; // scratch for encoding
+
+    // line numbers; size is m_total - m_dropped
+    std::size_t m_total = 0;
+    std::size_t m_dropped = 0;
+
+    // the one block currently mapped
+    mutable const char* m_map = nullptr;
+    mutable off_t m_map_offset = -1;
+
+    // guards everything above; lines are read by the search thread
+    mutable std::mutex m_mutex;
+};
+
+void HistoryImpl::push(const screenRow& row)
+{
+    std::lock_guard lock{m_mutex};
+
+    const auto cap = m_ring_cap;
+    if (cap == 0) {
+        if (spilling()) {
+            spill(row);
+            m_total++;
+            trim();
+        }
+        return;
+    }
+
+    if (m_ring_size < cap) {
+        // still filling the ring, or refilling after a pop
+        if (m_ring.size() < cap)
+            m_ring.push_back(row);
+        else
+            m_ring[(m_ring_head + m_ring_size) % cap].assign(
+                    row.begin(), row.end());
+        m_ring_size++;
+    } else {
+        // evict the oldest line, reusing its storage
+        auto& oldest = m_ring[m_ring_head];
+        if (spilling())
+            spill(oldest);
+        else
+            m_dropped++;
+
+        oldest.assign(row.begin(), row.end());
+        m_ring_head = (m_ring_head + 1) % cap;
+    }
+
+    m_total++;
+    if (spilling())
+        trim();
+}
+
+bool HistoryImpl::pop(screenRow& row)
+{
+    std::lock_guard lock{m_mutex};
+    if (m_total == m_dropped)
+        return false;
+
+    if (m_ring_size) {
+        const auto newest = (m_ring_head + m_ring_size - 1) % m_ring.size();
+        row.swap(m_ring[newest]);
+        // until the ring first fills, it only grows at the back
+        if (m_ring.size() < m_ring_cap)
+            m_ring.pop_back();
+        m_ring_size--;
+        m_total--;
+        return true;
+    }
+
+    if (!m_staging_lines && !unseal())
+        return false;
+
+    // the newest spilled line is the last one staged
+    const char* p = m_staging.data();
+    for (std::size_t i = 0; i + 1 < m_staging_lines; i++)
+        skip(p);
+    const auto start = p - m_staging.data();
+    decode(p, row);
+
+    m_staging.resize(start);
+    m_staging_lines--;
+    m_total--;
+    return true;
+}
+
+void HistoryImpl::spill(const screenRow& row)
+{
+    m_enc.clear();
+    encode(row, m_enc);
+    if (m_enc.size() > block_size) {
+        // far too wide to ever fit; shouldn't happen with real widths
+        LOGGER()->warn("dropping {} col line from history", row.size());
+        m_enc.clear();
+        encode({}, m_enc);
+    }
+
+    if (m_staging.size() + m_enc.size() > block_size) {
+        seal();
+        if (!spilling()) {
+            m_dropped++; // sealing failed, and spilling stopped
+            return;
+        }
+    }
+
+    if (m_staging.capacity() < block_size)
+        m_staging.reserve(block_size);
+
+    m_staging.append(m_enc);
+    m_staging_lines++;
+}
+
+void HistoryImpl::seal()
+{
+    if (!m_staging_lines)
+        return;
+
+    // blocks are fixed size, so the unused tail is padded
+    m_staging.resize(block_size);
+    if (pwrite(m_fd, m_staging.data(), block_size, m_next_offset) !=
+            static_cast<ssize_t>(block_size)) {
+        // give up on spilling; evicted lines are dropped from now on
+        LOGGER()->error("error spilling history: {}", strerror(errno));
+        m_blocks.clear();
+        m_dropped = m_total - m_ring_size;
+        close_spill();
+    } else {
+        m_blocks.push_back({staging_first(), m_staging_lines, m_next_offset});
+        m_next_offset += block_size;
+    }
+
+    m_staging.clear();
+    m_staging_lines = 0;
+}
+
+// reads the newest block back into staging, so lines can be popped
+// from it
+bool HistoryImpl::unseal()
+{
+    if (m_blocks.empty())
+        return false;
+
+    const auto block = m_blocks.back();
+    if (m_map_offset == block.offset)
+        unmap();
+
+    m_staging.resize(block_size);
+    if (pread(m_fd, m_staging.data(), block_size, block.offset) !=
+            static_cast<ssize_t>(block_size)) {
+        LOGGER()->error("error reading history: {}", strerror(errno));
+        m_staging.clear();
+        return false;
+    }
+
+    // drop the padding after the last line
+    const char* p = m_staging.data();
+    for (std::size_t i = 0; i < block.lines; i++)
+        skip(p);
+    m_staging.resize(p - m_staging.data());
+    m_staging_lines = block.lines;
+
+    // it's the newest block, so its space is the next to be written
+    fallocate(m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+            block.offset, block_size);
+    m_next_offset = block.offset;
+    m_blocks.pop_back();
+    return true;
+}
+
+// drops whole blocks from the front while the rest still holds
+// max_lines
+void HistoryImpl::trim()
+{
+    while (!m_blocks.empty() &&
+            m_total - m_dropped - m_blocks.front().lines >= m_opts.max_lines) {
+        const auto& block = m_blocks.front();
+        if (m_map_offset == block.offset)
+            unmap();
+
+        // give the space back; offsets keep growing, but the file
+        // stays sparse
+        fallocate(m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                block.offset, block_size);
+
+        m_dropped = block.first + block.lines;
+        m_blocks.pop_front();
+    }
+}
+
+const char* HistoryImpl::map(const Block& block) const
+{
+    if (m_map_offset == block.offset)
+        return m_map;
+
+    unmap();
+
+    void* p = mmap(nullptr, block_size, PROT_READ, MAP_SHARED, m_fd,
+            block.offset);
+    if (p == MAP_FAILED) {
+        LOGGER()->error("unable to map history block: {}", strerror(errno));
+        m_map = nullptr;
+        m_map_offset = -1;
+        return nullptr;
+    }
+
+    m_map = static_cast<const char*>(p);
+    m_map_offset = block.offset;
+    return m_map;
+}
+
+bool HistoryImpl::lineat(std::size_t n, screenRow& row) const
+{
+    std::lock_guard lock{m_mutex};
+    if (n < m_dropped || n >= m_total)
+        return false;
+
+    const auto ring_first = m_total - m_ring_size;
+    if (n >= ring_first) {
+        const auto& src = m_ring[(m_ring_head + (n - ring_first)) % m_ring.size()];
+        row.assign(src.begin(), src.end());
+        return true;
+    }
+
+    const char* p;
+    std::size_t skipped;
+    if (n >= staging_first()) {
+        p = m_staging.data();
+        skipped = n - staging_first();
+    } else {
+        auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), n,
+                [](std::size_t n, const Block& b) { return n < b.first; });
+        const auto& block = *std::prev(it);
+        if (!(p = map(block)))
+            return false;
+        skipped = n - block.first;
+    }
+
+    while (skipped--)
+        skip(p);
+    decode(p, row);
+    return true;
+}
+
+void HistoryImpl::unmap() const
+{
+    if (m_map) {
+        munmap(const_cast<char*>(m_map), block_size);
+        m_map = nullptr;
+        m_map_offset = -1;
+    }
+}
+
+void HistoryImpl::close_spill()
+{
+    unmap();
+
+    if (m_fd != -1) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+History::History() :
+    impl(std::make_unique<HistoryImpl>())
+{}
+
+History::~History() = default;
+
+void History::configure(const Options& opts)
+{
+    impl->configure(opts);
+}
+
+void History::push(const screenRow& row)
+{
+    impl->push(row);
+}
+
+bool History::pop(screenRow& row)
+{
+    return impl->pop(row);
+}
+
+void History::clear()
+{
+    impl->clear();
+}
+
+std::size_t History::size() const
+{
+    return impl->size();
+}
+
+screenRow History::line(std::size_t i) const
+{
+    screenRow row;
+    impl->lineat(impl->first() + i, row);
+    return row;
+}
+
+std::size_t History::first() const
+{
+    return impl->first();
+}
+
+std::size_t History::total() const
+{
+    return impl->total();
+}
+
+bool History::lineat(std::size_t n, screenRow& row) const
+{
+    return impl->lineat(n, row);
+}
+
+std::size_t History::memsize() const
+{
+    return impl->memsize();
+}
+
+std::size_t History::spillsize() const
+{
+    return impl->spillsize();
+}
+
+} // namespace screen
@@ -1,6 +1,7 @@
 #include "lua/logging.h"
 #include "lua/state.h"
 #include "rw/logging.h"
+#include "rwte/asynclog.h"
 
 using namespace std::literals;
 
@@ -61,7 +62,7 @@ static int logger_log(lua_State* l)
 
     L.pop(); // pop tostring
 
-    logger->log(level, msg.c_str());
+    asynclog::write(logger, level, std::move(msg));
     return 0;
 }
 
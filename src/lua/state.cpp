@@ -268,6 +268,11 @@ float State::tonumberdef(int index, float def)
         return def;
 }
 
+void State::pushnumber(double n)
+{
+    lua_pushnumber(m_L, n);
+}
+
 bool State::tobool(int index)
 {
     return lua_toboolean(m_L, index) != 0;
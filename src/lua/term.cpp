@@ -1,8 +1,16 @@
 #include "lua/state.h"
 #include "lua/term.h"
 #include "rw/logging.h"
+#include "rwte/perf.h"
+#include "rwte/search.h"
+#include "rwte/selection.h"
+#include "rwte/seltext.h"
 #include "rwte/term.h"
 
+#include <chrono>
+#include <optional>
+#include <string_view>
+
 /// Term module; `term` is the global terminal object.
 // @module term
 
@@ -11,12 +19,21 @@
 static int term_ref = LUA_NOREF;
 
 const char* const LUATERM = "LUATERM*";
+const char* const LUASELTEXT = "LUASELTEXT*";
+
+// bytes returned by each call of a selection iterator
+constexpr std::size_t selection_chunk = 64 * 1024;
 
 struct LuaTermStruct
 {
     std::weak_ptr<term::Term> term;
 };
 
+struct LuaSelTextStruct
+{
+    std::optional<screen::SelectionText> text;
+};
+
 // todo: merge this with lua window's getwindow, and turn it into
 // a sort of generic "get shared object" func in lua::State
 static inline std::shared_ptr<term::Term> getterm(lua::State& L)
@@ -58,6 +75,18 @@ constexpr luaL_Reg term_obj_funcs[] = {
         {nullptr, nullptr},
 };
 
+static int seltext_gc(lua_State* l)
+{
+    lua::State(l).delobj<LuaSelTextStruct>(1, LUASELTEXT);
+    return 0;
+}
+
+// methods for selection text object
+constexpr luaL_Reg seltext_obj_funcs[] = {
+        {"__gc", seltext_gc},
+        {nullptr, nullptr},
+};
+
 /// Returns whether a terminal mode is set.
 //
 // @function mode
@@ -109,20 +138,202 @@ static int luaterm_clipcopy(lua_State* l)
     return 0;
 }
 
+/// Cancels a paste in progress, dropping what hasn't been sent yet.
+//
+// @function pastecancel
+// @usage
+// term.pastecancel()
+static int luaterm_pastecancel(lua_State* l)
+{
+    lua::State L(l);
+    if (auto term = getterm(L))
+        term->pastecancel();
+
+    return 0;
+}
+
+static double to_ms(perf::clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+/// Returns runtime statistics, totals since startup.
+//
+// Fields are `bytes_read` and `bytes_written` (pty traffic),
+// `seq_control`, `seq_esc`, `seq_csi` and `seq_str` (sequences
+// handled), `frames`, `frames_held` (refreshes held by synchronized
+// updates), `parse_ms`, `render_ms`, `lua_ms`, `peak_write_buffer`,
+// `screen_bytes` and `cache_bytes`.
+//
+// @function stats
+// @treturn table Statistics
+// @usage
+// print(term.stats().frames)
+static int luaterm_stats(lua_State* l)
+{
+    lua::State L(l);
+    const auto& stats = perf::stats();
+
+    auto seqs = [&](perf::Seq kind) {
+        return static_cast<double>(stats.seqs[static_cast<int>(kind)]);
+    };
+
+    L.newtable();
+    L.pushnumber(stats.pty_read);
+    L.setfield(-2, "bytes_read");
+    L.pushnumber(stats.pty_written);
+    L.setfield(-2, "bytes_written");
+    L.pushnumber(seqs(perf::Seq::Control));
+    L.setfield(-2, "seq_control");
+    L.pushnumber(seqs(perf::Seq::Esc));
+    L.setfield(-2, "seq_esc");
+    L.pushnumber(seqs(perf::Seq::Csi));
+    L.setfield(-2, "seq_csi");
+    L.pushnumber(seqs(perf::Seq::Str));
+    L.setfield(-2, "seq_str");
+    L.pushnumber(stats.frames);
+    L.setfield(-2, "frames");
+    L.pushnumber(stats.frames_held);
+    L.setfield(-2, "frames_held");
+    L.pushnumber(to_ms(stats.parse));
+    L.setfield(-2, "parse_ms");
+    L.pushnumber(to_ms(stats.render));
+    L.setfield(-2, "render_ms");
+    L.pushnumber(to_ms(stats.lua));
+    L.setfield(-2, "lua_ms");
+    L.pushnumber(stats.peak_write_buffer);
+    L.setfield(-2, "peak_write_buffer");
+
+    auto term = getterm(L);
+    L.pushnumber(term ? term->memsize() : 0);
+    L.setfield(-2, "screen_bytes");
+    // todo: report cache memory, once there are caches
+    L.pushnumber(0);
+    L.setfield(-2, "cache_bytes");
+
+    return 1;
+}
+
+/// Searches the screen and scrollback for a string.
+//
+// Matching is literal, and ignores case unless the string has
+// uppercase letters. Calling again with the same string moves to the
+// next match in the given direction; a nil or empty string ends the
+// search. Matches are highlighted while searching, the current one
+// reversed.
+//
+// @function search
+// @string s String to search for
+// @string[opt="prev"] direction `"prev"` to search up, `"next"` down
+// @treturn table Match, with `row`, `col` and `len` fields, or nil if
+// there are no more. Rows below zero are in the scrollback, -1 being
+// the newest line there.
+// @usage
+// m = term.search("error")
+static int luaterm_search(lua_State* l)
+{
+    lua::State L(l);
+    auto term = getterm(L);
+    if (!term)
+        return 0;
+
+    auto pattern = L.tostring(1);
+    auto direction = L.tostring(2);
+
+    if (pattern != term->searchpattern())
+        term->search(pattern);
+    if (pattern.empty())
+        return 0;
+
+    search::Match match;
+    if (!term->searchstep(direction == "next" ? 1 : -1, match)) {
+        L.pushnil();
+        return 1;
+    }
+
+    const auto base = term->searchbase();
+    L.newtable();
+    L.pushnumber(static_cast<double>(match.line) - static_cast<double>(base));
+    L.setfield(-2, "row");
+    L.pushinteger(match.col);
+    L.setfield(-2, "col");
+    L.pushinteger(match.len);
+    L.setfield(-2, "len");
+
+    return 1;
+}
+
+// iterator returned by luaterm_selection; the selection text
+// is its upvalue
+static int seltext_next(lua_State* l)
+{
+    lua::State L(l);
+    auto p = L.checkobj<LuaSelTextStruct>(lua::State::upvalueindex(1),
+            LUASELTEXT);
+    if (!p->text)
+        return 0;
+
+    std::string chunk;
+    if (!p->text->read(chunk, selection_chunk))
+        p->text.reset();
+    if (chunk.empty())
+        return 0;
+
+    L.pushstring(chunk);
+    return 1;
+}
+
+/// Returns an iterator over the text of a selection.
+//
+// The text is taken when this is called, and is returned a piece at a
+// time, so a large selection is never held as one string. Pieces may
+// end in the middle of a line.
+//
+// @function selection
+// @string[opt="primary"] which `"primary"` or `"clipboard"`
+// @treturn function Iterator returning the next piece of text, or nil
+// after the last
+// @usage
+// for s in term.selection() do io.write(s) end
+static int luaterm_selection(lua_State* l)
+{
+    lua::State L(l);
+    auto term = getterm(L);
+    if (!term)
+        return 0;
+
+    const auto& sel = term->sel();
+    const auto& text = L.tostring(1) == "clipboard" ? sel.clipboard :
+                                                       sel.primary;
+
+    auto p = L.newobj<LuaSelTextStruct>(LUASELTEXT);
+    if (text) {
+        p->text = *text;
+        p->text->rewind();
+    }
+
+    L.pushcclosure(seltext_next, 1);
+    return 1;
+}
+
 // functions for term library
 constexpr luaL_Reg term_funcs[] = {
         {"mode", luaterm_mode},
         {"send", luaterm_send},
         {"clipcopy", luaterm_clipcopy},
+        {"pastecancel", luaterm_pastecancel},
+        {"stats", luaterm_stats},
+        {"search", luaterm_search},
+        {"selection", luaterm_selection},
         {nullptr, nullptr}};
 
 static int term_openf(lua_State* l)
 {
     lua::State L(l);
 
-    // make the lib (3 funcs, 1 values)
-    // todo: verify that 4 is right
-    L.newlib(term_funcs, 4);
+    // make the lib (7 funcs, 1 values)
+    // todo: verify that 8 is right
+    L.newlib(term_funcs, 8);
 
     /// Mode flag table; maps mode flags to their integer value.
     // @class field
@@ -154,12 +365,16 @@ static int term_openf(lua_State* l)
     PUSH_ENUM_FIELD(MODE_PRINT);
     PUSH_ENUM_FIELD(MODE_UTF8);
     PUSH_ENUM_FIELD(MODE_SIXEL);
+    PUSH_ENUM_FIELD(MODE_SYNC);
 #undef PUSH_ENUM_FIELD
     L.setfield(-2, "modes");
 
     // add LUATERM object
     L.setobjfuncs(LUATERM, term_obj_funcs);
 
+    // add LUASELTEXT object, held by selection iterators
+    L.setobjfuncs(LUASELTEXT, seltext_obj_funcs);
+
     return 1;
 }
 
@@ -0,0 +1,70 @@
+#include "lua/state.h"
+#include "lua/trace.h"
+#include "rwte/trace.h"
+
+#include <string>
+
+/// Trace module; records timed spans from the reactor, parser and
+/// renderer, to be viewed in chrome://tracing or Perfetto.
+// @module trace
+
+/// Starts recording spans.
+// @function start
+// @usage trace.start()
+static int trace_start(lua_State* l)
+{
+    trace::start();
+    return 0;
+}
+
+/// Stops recording spans. Recorded spans are kept until dumped.
+// @function stop
+// @usage trace.stop()
+static int trace_stop(lua_State* l)
+{
+    trace::stop();
+    return 0;
+}
+
+/// Writes recorded spans as Chrome trace event json.
+// @function dump
+// @string[opt] path File to write; defaults to rwte-<pid>.trace.json
+// in TMPDIR or /tmp
+// @treturn string|nil Path written, or nil on error
+// @usage trace.dump("/tmp/rwte.json")
+static int trace_dump(lua_State* l)
+{
+    lua::State L(l);
+
+    std::string path;
+    if (L.gettop() >= 1 && !L.isnil(1))
+        path = L.checkstring(1);
+    else
+        path = trace::default_path();
+
+    if (trace::dump(path))
+        L.pushstring(path);
+    else
+        L.pushnil();
+    return 1;
+}
+
+// functions for trace library
+constexpr luaL_Reg trace_funcs[] = {
+        {"start", trace_start},
+        {"stop", trace_stop},
+        {"dump", trace_dump},
+        {nullptr, nullptr}};
+
+static int trace_openf(lua_State* l)
+{
+    lua::State L(l);
+    L.newlib(trace_funcs);
+    return 1;
+}
+
+void lua::register_luatrace(lua::State* L)
+{
+    L->requiref("trace", trace_openf, true);
+    L->pop();
+}
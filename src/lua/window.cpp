@@ -2,7 +2,9 @@
 #include "lua/window.h"
 #include "rw/logging.h"
 #include "rwte/coords.h"
+#include "rwte/perf.h"
 #include "rwte/rwte.h"
+#include "rwte/trace.h"
 #include "rwte/window.h"
 
 using namespace std::literals;
@@ -142,6 +144,28 @@ static int luawindow_selpaste(lua_State* l)
     return 0;
 }
 
+/// Shows or hides the performance hud, an overlay with frame rate,
+// render and parse times, dirty rows and pty throughput.
+//
+// @function perf_hud
+// @bool[opt] enable Whether to show the hud; toggles if omitted
+// @treturn bool Whether the hud is now shown
+// @usage window.perf_hud()
+static int luawindow_perf_hud(lua_State* l)
+{
+    lua::State L(l);
+
+    bool enable = !perf::hud();
+    if (L.gettop() >= 1)
+        enable = L.tobooldef(1, enable);
+
+    perf::set_hud(enable);
+    rwte->refresh();
+
+    L.pushbool(enable);
+    return 1;
+}
+
 /// Window identifier.
 //
 // (implemented via `__index`)
@@ -192,15 +216,16 @@ constexpr luaL_Reg window_lib_funcs[] = {
         {"key_press", luawindow_key_press},
         {"clippaste", luawindow_clippaste},
         {"selpaste", luawindow_selpaste},
+        {"perf_hud", luawindow_perf_hud},
         {nullptr, nullptr}};
 
 static int window_openf(lua_State* l)
 {
     lua::State L(l);
 
-    // make the lib (4 funcs, 1 value)
-    // todo: verify that 5 is right
-    L.newlib(window_lib_funcs, 5);
+    // make the lib (5 funcs, 1 value)
+    // todo: verify that 6 is right
+    L.newlib(window_lib_funcs, 6);
 
     // add keys table. Note that this table is quite
     // incomplete; there's no reason for this other than
@@ -418,7 +443,11 @@ bool lua::window::call_mouse_press(lua::State* L, const Cell& cell, int button,
     L->setfield(-2, "logo");
     // todo: include num
 
-    if (L->pcall(4, 1, 0) == LUA_OK) {
+    TRACE_SCOPE("lua mouse_press");
+    const auto start = perf::clock::now();
+    const int status = L->pcall(4, 1, 0);
+    perf::luacall(perf::clock::now() - start);
+    if (status == LUA_OK) {
         bool result = L->tobool(-1);
         L->pop(1);
         return result;
@@ -448,7 +477,11 @@ bool lua::window::call_key_press(lua::State* L, int keysym,
     L->setfield(-2, "logo");
     // todo: include num
 
-    if (L->pcall(2, 1, 0) == LUA_OK) {
+    TRACE_SCOPE("lua key_press");
+    const auto start = perf::clock::now();
+    const int status = L->pcall(2, 1, 0);
+    perf::luacall(perf::clock::now() - start);
+    if (status == LUA_OK) {
         bool result = L->tobool(-1);
         L->pop(1);
         return result;
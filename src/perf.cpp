@@ -0,0 +1,159 @@
+#include "rw/logging.h"
+#include "rwte/perf.h"
+
+#define LOGGER() (rw::logging::get("perf"))
+
+namespace perf {
+
+namespace {
+
+// totals for the window in progress
+struct Totals
+{
+    uint64_t frames = 0;
+    uint64_t flushes = 0;
+    uint64_t pty_bytes = 0;
+    uint64_t dirty_rows = 0;
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+    clock::duration render{};
+    clock::duration parse{};
+};
+
+constexpr clock::duration window = std::chrono::seconds{1};
+
+Totals totals;
+clock::time_point window_start = clock::now();
+Rates last;
+Stats cumulative;
+bool hud_enabled = false;
+
+double ms(clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void roll(clock::time_point now)
+{
+    const auto elapsed = now - window_start;
+    if (elapsed < window)
+        return;
+
+    const double secs = std::chrono::duration<double>(elapsed).count();
+    const double frames = totals.frames ? totals.frames : 1;
+
+    last.fps = totals.frames / secs;
+    last.flushes = totals.flushes / secs;
+    last.frame_ms = ms(totals.render) / frames;
+    last.pty_bytes = totals.pty_bytes / secs;
+    last.parse_ms = ms(totals.parse) / frames;
+    last.dirty_rows = totals.dirty_rows / frames;
+    last.cache_hits = totals.cache_hits;
+    last.cache_misses = totals.cache_misses;
+
+    totals = {};
+    window_start = now;
+}
+
+} // namespace
+
+void pty_read(std::size_t bytes)
+{
+    totals.pty_bytes += bytes;
+    cumulative.pty_read += bytes;
+}
+
+void parsed(clock::duration time)
+{
+    totals.parse += time;
+    cumulative.parse += time;
+}
+
+void flushed()
+{
+    totals.flushes++;
+}
+
+void drawn(clock::duration time, int dirty_rows)
+{
+    totals.frames++;
+    totals.render += time;
+    totals.dirty_rows += dirty_rows;
+    cumulative.frames++;
+    cumulative.render += time;
+
+    roll(clock::now());
+}
+
+void cache(bool hit)
+{
+    if (hit)
+        totals.cache_hits++;
+    else
+        totals.cache_misses++;
+}
+
+void pty_written(std::size_t bytes)
+{
+    cumulative.pty_written += bytes;
+}
+
+void write_buffered(std::size_t bytes)
+{
+    if (bytes > cumulative.peak_write_buffer)
+        cumulative.peak_write_buffer = bytes;
+}
+
+void seq(Seq kind)
+{
+    cumulative.seqs[static_cast<int>(kind)]++;
+}
+
+void held()
+{
+    cumulative.frames_held++;
+}
+
+void luacall(clock::duration time)
+{
+    cumulative.lua += time;
+}
+
+const Rates& rates()
+{
+    return last;
+}
+
+const Stats& stats()
+{
+    return cumulative;
+}
+
+void log_stats(std::size_t screen_bytes)
+{
+    const auto& s = cumulative;
+    LOGGER()->info("pty: {} bytes read, {} written, peak write buffer {}",
+            s.pty_read, s.pty_written, s.peak_write_buffer);
+    LOGGER()->info("sequences: {} control, {} esc, {} csi, {} str",
+            s.seqs[static_cast<int>(Seq::Control)],
+            s.seqs[static_cast<int>(Seq::Esc)],
+            s.seqs[static_cast<int>(Seq::Csi)],
+            s.seqs[static_cast<int>(Seq::Str)]);
+    LOGGER()->info("frames: {} drawn, {} held", s.frames, s.frames_held);
+    LOGGER()->info("time: parse {:.1f} ms, render {:.1f} ms, lua {:.1f} ms",
+            ms(s.parse), ms(s.render), ms(s.lua));
+    LOGGER()->info("memory: screen {} bytes, glyph caches 0 bytes",
+            screen_bytes);
+}
+
+bool hud()
+{
+    return hud_enabled;
+}
+
+void set_hud(bool enable)
+{
+    hud_enabled = enable;
+}
+
+} // namespace perf
@@ -0,0 +1,159 @@
+#include "rw/logging.h"
+#include "rwte/printlog.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define LOGGER() (rw::logging::get("printlog"))
+
+namespace printlog {
+
+// staged output is handed off once it reaches this size, even
+// mid-read
+constexpr std::size_t staging_size = 64 * 1024;
+
+Writer::Writer(int fd, std::string path, const Options& opts) :
+    m_fd(fd),
+    m_path(std::move(path)),
+    m_opts(opts)
+{
+    m_staging.reserve(staging_size);
+    m_thread = std::thread{&Writer::run, this};
+}
+
+Writer::~Writer()
+{
+    flush();
+
+    {
+        std::lock_guard lock{m_mutex};
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+
+    if (m_fd != -1 && m_fd != STDOUT_FILENO)
+        close(m_fd);
+}
+
+void Writer::print(std::string_view data)
+{
+    m_staging.append(data);
+    if (m_staging.size() >= staging_size)
+        flush();
+}
+
+void Writer::flush()
+{
+    if (m_staging.empty())
+        return;
+
+    {
+        std::unique_lock lock{m_mutex};
+
+        // back-pressure: if the writer can't keep up, wait for it
+        // rather than growing without bound or losing output. what
+        // it's writing counts, so that's all that's held.
+        auto held = [this] { return m_pending.size() + m_inflight; };
+        if (held() >= m_opts.max_pending) {
+            LOGGER()->debug("waiting on writer, {} bytes pending", held());
+            m_drained.wait(lock, [&] {
+                return held() < m_opts.max_pending;
+            });
+        }
+
+        if (m_pending.empty())
+            std::swap(m_pending, m_staging);
+        else
+            m_pending.append(m_staging);
+    }
+
+    m_staging.clear();
+    m_wake.notify_one();
+}
+
+void Writer::run()
+{
+    std::string buf;
+
+    std::unique_lock lock{m_mutex};
+    for (;;) {
+        m_wake.wait(lock, [this] {
+            return !m_pending.empty() || m_stopping;
+        });
+
+        if (m_pending.empty())
+            break; // stopping, and everything's written
+
+        // take the pending output, leaving our emptied buffer (and
+        // its capacity) in its place
+        buf.clear();
+        std::swap(buf, m_pending);
+        m_inflight = buf.size();
+        lock.unlock();
+
+        write_out(buf);
+
+        lock.lock();
+        m_inflight = 0;
+        m_drained.notify_one();
+    }
+}
+
+void Writer::write_out(const std::string& buf)
+{
+    auto pdata = buf.data();
+    auto len = buf.size();
+
+    while (m_fd != -1 && len > 0) {
+        ssize_t r = ::write(m_fd, pdata, len);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+
+            LOGGER()->error("error writing in {}: {}",
+                    m_path.empty() ? "stdout" : m_path, strerror(errno));
+            if (m_fd != STDOUT_FILENO)
+                close(m_fd);
+            m_fd = -1;
+            break;
+        }
+
+        len -= r;
+        pdata += r;
+        m_written += r;
+    }
+
+    if (m_opts.rotate_bytes && m_written >= m_opts.rotate_bytes)
+        rotate();
+}
+
+void Writer::rotate()
+{
+    if (m_fd == -1 || m_path.empty())
+        return;
+
+    LOGGER()->debug("rotating {} after {} bytes", m_path, m_written);
+    close(m_fd);
+
+    // shift path.N-1 to path.N, ..., then path to path.1
+    for (int i = m_opts.keep - 1; i > 0; i--) {
+        auto from = m_path + "." + std::to_string(i);
+        auto to = m_path + "." + std::to_string(i + 1);
+        std::rename(from.c_str(), to.c_str());
+    }
+
+    if (m_opts.keep > 0)
+        std::rename(m_path.c_str(), (m_path + ".1").c_str());
+
+    m_fd = ::open(m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (m_fd < 0)
+        LOGGER()->error("error reopening {}: {}", m_path, strerror(errno));
+
+    m_written = 0;
+}
+
+} // namespace printlog
@@ -1,6 +1,7 @@
 #include "rw/logging.h"
 #include "rwte/reactor.h"
 #include "rwte/sigevent.h"
+#include "rwte/trace.h"
 
 #include <errno.h>
 #include <signal.h>
@@ -42,6 +43,8 @@ Reactor::Reactor()
         connect_handler(SIGINT);
         connect_handler(SIGHUP);
         connect_handler(SIGCHLD);
+        connect_handler(SIGUSR1);
+        connect_handler(SIGUSR2);
     } else {
         throw ReactorError(fmt::format("could not create epoll ({}): {}",
                 errno, strerror(errno)));
@@ -70,6 +73,10 @@ Reactor::~Reactor()
     if (m_blinkfd != -1) {
         close(m_blinkfd);
     }
+
+    if (m_syncfd != -1) {
+        close(m_syncfd);
+    }
 }
 
 void Reactor::set_ttyfd(int ttyfd)
@@ -150,6 +157,21 @@ void Reactor::stop_blink()
     }
 }
 
+void Reactor::start_sync(float secs)
+{
+    if (m_syncfd == -1) {
+        m_syncfd = make_timer();
+    }
+    set_timer(m_syncfd, secs, 0);
+}
+
+void Reactor::stop_sync()
+{
+    if (m_syncfd != -1) {
+        set_timer(m_syncfd, 0, 0);
+    }
+}
+
 int clear_timer(int fd) {
     uint64_t exp = 0;
     int res = read(fd, &exp, sizeof(uint64_t));
@@ -175,7 +197,11 @@ Event Reactor::wait()
     epoll_event events[5] = {};
 
     for (;;) {
-        auto cnt = epoll_wait(m_epfd, events, 4, -1);
+        int cnt;
+        {
+            TRACE_SCOPE("reactor wait");
+            cnt = epoll_wait(m_epfd, events, 4, -1);
+        }
 
         // if >0, it's a count, if ==0, unexpected timeout
         for (auto i = 0; i < cnt; i++) {
@@ -215,6 +241,12 @@ Event Reactor::wait()
                             case SIGCHLD:
                                 evt = ChildEnd{};
                                 break;
+                            case SIGUSR1:
+                                evt = StatsDump{};
+                                break;
+                            case SIGUSR2:
+                                evt = TraceToggle{};
+                                break;
                             case SIGTERM:
                                 [[fallthrough]];
                             case SIGINT:
@@ -258,6 +290,9 @@ Event Reactor::wait()
             } else if (m_blinkfd != -1 && events[i].data.fd == m_blinkfd) {
                 clear_timer(m_blinkfd);
                 return Blink{};
+            } else if (m_syncfd != -1 && events[i].data.fd == m_syncfd) {
+                clear_timer(m_syncfd);
+                return SyncTimeout{};
             }
 
             LOGGER()->error("received an unexpected fd {}", events[i].data.fd);
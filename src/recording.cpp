@@ -0,0 +1,181 @@
+#include "rw/logging.h"
+#include "rwte/recording.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+#define LOGGER() (rw::logging::get("recording"))
+
+namespace recording {
+
+constexpr std::string_view magic{"RWTEREC\x01", 8};
+
+Writer::Writer(int fd, int cols, int rows) :
+    m_fd(fd),
+    m_last(std::chrono::steady_clock::now())
+{
+    m_buf.append(magic);
+    put(cols);
+    put(rows);
+    flush();
+}
+
+Writer::~Writer()
+{
+    if (m_fd != -1 && m_fd != STDOUT_FILENO)
+        close(m_fd);
+}
+
+void Writer::data(std::string_view data)
+{
+    if (data.empty())
+        return;
+
+    record(data.size() << 1);
+    m_buf.append(data);
+    flush();
+}
+
+void Writer::resize(int cols, int rows)
+{
+    record(1);
+    put(cols);
+    put(rows);
+    flush();
+}
+
+void Writer::put(uint64_t v)
+{
+    do {
+        uint8_t b = v & 0x7f;
+        v >>= 7;
+        if (v)
+            b |= 0x80;
+        m_buf.push_back(static_cast<char>(b));
+    } while (v);
+}
+
+void Writer::record(uint64_t tag)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto delta = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - m_last);
+    m_last = now;
+
+    put(delta.count());
+    put(tag);
+}
+
+void Writer::flush()
+{
+    auto pdata = m_buf.data();
+    auto len = m_buf.size();
+
+    while (m_fd != -1 && len > 0) {
+        ssize_t r = ::write(m_fd, pdata, len);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+
+            LOGGER()->error("error writing recording: {}", strerror(errno));
+            if (m_fd != STDOUT_FILENO)
+                close(m_fd);
+            m_fd = -1;
+            break;
+        }
+
+        len -= r;
+        pdata += r;
+    }
+
+    m_buf.clear();
+}
+
+bool isrecording(const std::string& path)
+{
+    std::ifstream in{path, std::ios::binary};
+    std::string head(magic.size(), '\0');
+    return in.read(head.data(), head.size()) && head == magic;
+}
+
+Reader::Reader(const std::string& path)
+{
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        LOGGER()->error("could not open {}", path);
+        return;
+    }
+
+    m_file.assign(std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>());
+
+    if (std::string_view{m_file}.substr(0, magic.size()) != magic)
+        return;
+
+    m_pos = magic.size();
+    uint64_t cols, rows;
+    if (!get(&cols) || !get(&rows))
+        return;
+
+    m_cols = cols;
+    m_rows = rows;
+    m_start = m_pos;
+    m_ok = true;
+}
+
+bool Reader::next(Record& rec)
+{
+    uint64_t delta, tag;
+    if (!m_ok || !get(&delta) || !get(&tag))
+        return false;
+
+    m_time += std::chrono::microseconds{delta};
+    rec.time = m_time;
+
+    if (tag & 1) {
+        uint64_t cols, rows;
+        if (!get(&cols) || !get(&rows))
+            return false;
+
+        rec.kind = Record::Kind::Resize;
+        rec.data = {};
+        rec.cols = cols;
+        rec.rows = rows;
+    } else {
+        auto len = tag >> 1;
+        if (len > m_file.size() - m_pos) {
+            LOGGER()->warn("truncated recording");
+            return false;
+        }
+
+        rec.kind = Record::Kind::Data;
+        rec.data = std::string_view{m_file}.substr(m_pos, len);
+        m_pos += len;
+    }
+
+    return true;
+}
+
+void Reader::rewind()
+{
+    m_pos = m_start;
+    m_time = std::chrono::microseconds{0};
+}
+
+bool Reader::get(uint64_t* v)
+{
+    *v = 0;
+    for (int shift = 0; m_pos < m_file.size() && shift < 64; shift += 7) {
+        uint8_t b = m_file[m_pos++];
+        *v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+} // namespace recording
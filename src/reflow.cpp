@@ -0,0 +1,183 @@
+#include "rwte/reflow.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace screen {
+
+namespace {
+
+// source rows [first, last], joined by wrap into one line
+struct Line
+{
+    std::size_t first;
+    std::size_t last;
+    int content; // cells of content
+    int len;     // cells laid out; content, or more to hold a point
+    int rows;    // rows taken at the new width
+};
+
+} // namespace
+
+static bool wraps(const screenRow& row)
+{
+    return !row.empty() && row.back().attr.wrap;
+}
+
+// cells of src[i] that belong to its line. the last row of a line
+// loses its trailing blanks; other rows are whole, except for the
+// blank left at the end where a wide glyph didn't fit.
+static int rowcells(const std::vector<const screenRow*>& src, std::size_t i,
+        bool last)
+{
+    const auto& row = *src[i];
+    int n = row.size();
+
+    if (last) {
+        while (n > 0 && row[n - 1].u == empty_char)
+            n--;
+    } else if (n > 0 && row[n - 1].u == empty_char &&
+               !src[i + 1]->empty() && src[i + 1]->front().attr.wide) {
+        n--;
+    }
+
+    return n;
+}
+
+// calls fn(glyph, offset, row, col) for each cell of line, in order,
+// with the row and col it lands on when laid out cols wide. glyph is
+// null for cells past the content. returns the rows used.
+template <typename Fn>
+static int layout(const std::vector<const screenRow*>& src, const Line& line,
+        int cols, Fn&& fn)
+{
+    int row = 0;
+    int col = 0;
+    int n = 0;
+
+    auto place = [&](const Glyph* g) {
+        // wide glyphs move down whole, rather than being split
+        const bool wide = g && g->attr.wide && cols > 1;
+        if (col == cols || (wide && col + 2 > cols)) {
+            row++;
+            col = 0;
+        }
+        fn(g, n++, row, col++);
+    };
+
+    for (auto i = line.first; i <= line.last && n < line.content; i++) {
+        const auto& r = *src[i];
+        const int cells = rowcells(src, i, i == line.last);
+        for (int c = 0; c < cells && n < line.content; c++)
+            place(&r[c]);
+    }
+
+    while (n < line.len)
+        place(nullptr);
+
+    return row + 1;
+}
+
+// splits src into lines, and finds each point's offset in its line
+static std::vector<Line> splitlines(const std::vector<const screenRow*>& src,
+        int cols, const std::vector<Cell>& points,
+        std::vector<std::pair<std::size_t, int>>& offsets)
+{
+    std::vector<Line> lines;
+    offsets.assign(points.size(), {0, -1});
+
+    for (std::size_t i = 0; i < src.size(); i++) {
+        Line line{i, i, 0, 0, 0};
+        while (line.last + 1 < src.size() && wraps(*src[line.last]))
+            line.last++;
+
+        for (auto r = line.first; r <= line.last; r++) {
+            const int cells = rowcells(src, r, r == line.last);
+
+            for (std::size_t p = 0; p < points.size(); p++) {
+                const auto& pt = points[p];
+                if (pt.row < 0 || static_cast<std::size_t>(pt.row) != r)
+                    continue;
+
+                // points past the end of a wrapped row belong to it
+                int col = std::max(pt.col, 0);
+                if (r != line.last)
+                    col = std::min(col, std::max(cells - 1, 0));
+                offsets[p] = {lines.size(), line.content + col};
+                line.len = std::max(line.len, line.content + col + 1);
+            }
+
+            line.content += cells;
+        }
+
+        line.len = std::max(line.len, line.content);
+        line.rows = layout(src, line, cols, [](auto&&...) {});
+        lines.push_back(line);
+        i = line.last;
+    }
+
+    return lines;
+}
+
+int reflowrows(const std::vector<const screenRow*>& src, int cols,
+        const std::vector<Cell>& points)
+{
+    std::vector<std::pair<std::size_t, int>> offsets;
+    auto lines = splitlines(src, cols, points, offsets);
+
+    int rows = 0;
+    for (const auto& line : lines)
+        rows += line.rows;
+    return rows;
+}
+
+screenRows reflow(const std::vector<const screenRow*>& src, int cols,
+        const Glyph& blank, std::vector<Cell>& points)
+{
+    std::vector<std::pair<std::size_t, int>> offsets;
+    auto lines = splitlines(src, cols, points, offsets);
+
+    int total = 0;
+    for (const auto& line : lines)
+        total += line.rows;
+
+    screenRows out;
+    out.resize(total);
+    for (int i = 0; i < total; i++)
+        out[i].assign(cols, blank);
+
+    int base = 0;
+    for (std::size_t l = 0; l < lines.size(); l++) {
+        const auto& line = lines[l];
+
+        int last = -1;
+        screenRow* dst = nullptr;
+        layout(src, line, cols,
+                [&](const Glyph* g, int n, int row, int col) {
+                    if (g) {
+                        if (row != last) {
+                            dst = &out[base + row];
+                            last = row;
+                        }
+                        auto& d = (*dst)[col];
+                        d = *g;
+                        d.attr.wrap = 0;
+                    }
+
+                    for (std::size_t p = 0; p < points.size(); p++) {
+                        if (offsets[p].first == l && offsets[p].second == n)
+                            points[p] = {base + row, col};
+                    }
+                });
+
+        // every row but the last carries on to the next
+        for (int row = 0; row < line.rows - 1; row++)
+            out[base + row][cols - 1].attr.wrap = 1;
+
+        base += line.rows;
+    }
+
+    return out;
+}
+
+} // namespace screen
@@ -1,18 +1,24 @@
+#include "fmt/format.h"
 #include "lua/config.h"
 #include "lua/state.h"
 #include "rw/logging.h"
 #include "rw/utf8.h"
 #include "rwte/color.h"
 #include "rwte/config.h"
+#include "rwte/perf.h"
 #include "rwte/renderer.h"
 #include "rwte/rwte.h"
 #include "rwte/screen.h"
+#include "rwte/search.h"
 #include "rwte/selection.h"
 #include "rwte/term.h"
+#include "rwte/trace.h"
 
 #include <cairo/cairo-xcb.h> // for cairo_xcb_surface_set_size
+#include <algorithm>
 #include <cmath>
 #include <pango/pangocairo.h>
+#include <utility>
 #include <vector>
 
 #define LOGGER() (rw::logging::get("renderer"))
@@ -295,18 +301,48 @@ public:
     int charwidth() const { return m_cw; }
     int charheight() const { return m_ch; }
 
-    void drawregion(const Cell& begin, const Cell& end);
+    const std::vector<Rect>& drawregion(const Cell& begin, const Cell& end);
+    void invalidate();
 
     Cell pxtocell(int x, int y) const;
 
 private:
+    // what glyphs are drawn against; when any of it changes, every
+    // row has to be drawn again
+    struct FrameState
+    {
+        bool reverse;
+        uint32_t deffg, defbg;
+        int border_px;
+        int cw, ch;
+        int width, height;
+        int rows, cols;
+
+        bool operator==(const FrameState& other) const
+        {
+            return reverse == other.reverse && deffg == other.deffg &&
+                   defbg == other.defbg && border_px == other.border_px &&
+                   cw == other.cw && ch == other.ch &&
+                   width == other.width && height == other.height &&
+                   rows == other.rows && cols == other.cols;
+        }
+
+        bool operator!=(const FrameState& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    void damage(int x1, int y1, int x2, int y2);
     void clear(Context& cr, int x1, int y1, int x2, int y2);
     void drawglyph(Context& cr, PangoLayout* layout,
             const screen::Glyph& glyph, const Cell& cell);
     void drawglyphs(Context& cr, PangoLayout* layout,
             const screen::glyph_attribute& attr, uint32_t fg, uint32_t bg,
             const std::vector<char32_t>& runes, const Cell& cell);
-    void drawcursor(Context& cr, PangoLayout* layout);
+    void drawcursor(Context& cr, PangoLayout* layout,
+            const screen::ScreenView& view, const screen::Glyph& og);
+    void drawhud(Context& cr, PangoLayout* layout);
     void load_font(Context& cr);
 
     term::Term* m_term;
@@ -317,9 +353,19 @@ private:
     std::unique_ptr<Surface> m_surface;
 
     int m_cw = 0, m_ch = 0;
+    bool m_hudshown = false;
     int m_width = 0, m_height = 0;
     Cell m_lastcur{0, 0};
 
+    // each row's glyphs as last drawn, empty if it has to be drawn
+    // whatever it holds, and the state they were drawn under
+    std::vector<std::vector<screen::Glyph>> m_shadow;
+    FrameState m_state{};
+
+    // painted since the last drawregion, and what it last returned
+    Damage m_damage;
+    std::vector<Rect> m_drawn;
+
     int m_border_px;
 };
 
@@ -387,17 +433,39 @@ void RendererImpl::resize(int width, int height)
         cr.fill();
     }
 
-    m_width = width;
-    m_height = height;
+    // damage is kept to the surface, so mark it once it's grown
+    const int oldwidth = std::exchange(m_width, width);
+    const int oldheight = std::exchange(m_height, height);
+    if (oldwidth < width)
+        damage(oldwidth, 0, width, oldheight);
+    if (oldheight < height)
+        damage(0, oldheight, width, height);
 
     LOGGER()->info("resize to {}x{}", width, height);
 }
 
-void RendererImpl::drawregion(const Cell& begin, const Cell& end)
+// whether a and b are drawn the same
+static bool same(const screen::Glyph& a, const screen::Glyph& b)
 {
+    return a.u == b.u && a.attr == b.attr && a.fg == b.fg && a.bg == b.bg;
+}
+
+const std::vector<Rect>& RendererImpl::drawregion(const Cell& begin,
+        const Cell& end)
+{
+    TRACE_SCOPE("drawregion");
+    const auto start = perf::clock::now();
+
     // freshen up border_px
     m_border_px = get_border_px();
 
+    // the hud was drawn over the last frame; repaint it away
+    if (m_hudshown && !perf::hud()) {
+        invalidate();
+        m_term->setdirty();
+        m_hudshown = false;
+    }
+
     auto cr = m_surface->cr();
     auto layout = m_surface->layout();
 
@@ -413,57 +481,156 @@ void RendererImpl::drawregion(const Cell& begin, const Cell& end)
     return;
     */
 
+    // read glyphs from a snapshot rather than the live screen
+    const auto view = m_term->snapshot();
+
     auto& sel = m_term->sel();
     bool ena_sel = !sel.empty() &&
                    sel.alt == m_term->mode()[term::MODE_ALTSCREEN];
 
+    // search matches are underlined, and the current one reversed
+    const auto& pattern = m_term->searchpattern();
+    const auto searchbase = m_term->searchbase();
+    search::Match current{};
+    const bool has_current = m_term->searchcurrent(current);
+    std::vector<search::Match> matches;
+    auto mark = [&](const Cell& c, screen::glyph_attribute& attr) {
+        for (const auto& m : matches) {
+            if (m.col <= c.col && c.col < m.col + m.len) {
+                attr.underline = 1;
+                if (has_current && m.line == current.line &&
+                        m.col == current.col)
+                    attr.reverse ^= 1;
+                break;
+            }
+        }
+    };
+
+    // blinking glyphs are hidden in this phase
+    const bool blinkoff = m_term->mode()[term::MODE_BLINK];
+    const int cols = m_term->cols();
+
+    // the glyphs in [first, last) of a row as they'll be drawn,
+    // selected ones and search matches marked, with only what
+    // changes how they look
+    std::vector<screen::Glyph> glyphs;
+    auto rowglyphs = [&](int row, int first, int last) {
+        matches.clear();
+        if (!pattern.empty())
+            search::findrow(view.line(row), pattern,
+                    searchbase + row, matches);
+
+        const auto span = ena_sel ? sel.span(row) : Selection::Span{};
+
+        glyphs.resize(cols);
+        for (Cell c{row, first}; c.col < last; c.col++) {
+            auto& g = glyphs[c.col];
+            g = view.glyph(c);
+            if (!g.attr.wdummy) {
+                if (span.contains(c.col))
+                    g.attr.reverse ^= 1;
+                mark(c, g.attr);
+            }
+            g.attr.wrap = 0;
+            g.attr.blink = g.attr.blink && blinkoff;
+        }
+    };
+
+    // rows drawn under other frame state have to be drawn again
+    const FrameState state{m_term->mode()[term::MODE_REVERSE],
+            m_term->deffg(), m_term->defbg(), m_border_px, m_cw, m_ch,
+            m_width, m_height, m_term->rows(), m_term->cols()};
+    if (state != m_state) {
+        m_state = state;
+        invalidate();
+    }
+    m_shadow.resize(m_term->rows());
+
     std::vector<char32_t> runes;
+    int dirty_rows = 0;
     Cell cell;
     for (cell.row = begin.row; cell.row < end.row; cell.row++) {
         if (!m_term->isdirty(cell.row))
             continue;
 
         m_term->cleardirty(cell.row);
+        rowglyphs(cell.row, begin.col, end.col);
+
+        // apps often rewrite what's already there; skip runs of
+        // glyphs drawn the same way last time
+        auto& shadow = m_shadow[cell.row];
+        const bool known = shadow.size() == static_cast<std::size_t>(cols);
+        auto unchanged = [&](int first, int last) {
+            return known && std::equal(glyphs.begin() + first,
+                                    glyphs.begin() + last,
+                                    shadow.begin() + first, same);
+        };
+        if (unchanged(begin.col, end.col))
+            continue;
 
+        dirty_rows++;
+
+        // wide glyphs are drawn across the run after them, so that's
+        // drawn again whenever they are
+        bool spill = false;
         cell.col = begin.col;
         while (cell.col < end.col) {
             runes.clear();
 
-            // making a copy, because we want to reverse it if it's
-            // selected, without modifying the original
-            screen::Glyph g = m_term->glyph(cell);
-            if (!g.attr.wdummy) {
-                if (ena_sel && sel.selected(cell)) {
-                    g.attr.reverse ^= 1;
-                }
-            }
-
+            const auto& g = glyphs[cell.col];
             runes.push_back(g.u);
 
             for (int lookahead = cell.col + 1; lookahead < end.col; lookahead++) {
-                const screen::Glyph& g2 = m_term->glyph(
-                        {cell.row, lookahead});
-                screen::glyph_attribute attr2 = g2.attr;
-                if (!attr2.wdummy) {
-                    if (ena_sel && sel.selected({cell.row, lookahead})) {
-                        attr2.reverse ^= 1;
-                    }
-                }
-
-                if (g.attr != attr2 || g.fg != g2.fg || g.bg != g2.bg)
+                const auto& g2 = glyphs[lookahead];
+                if (g.attr != g2.attr || g.fg != g2.fg || g.bg != g2.bg)
                     break;
 
                 runes.push_back(g2.u);
             }
 
-            drawglyphs(cr, layout, g.attr, g.fg, g.bg, runes, cell);
-            cell.col += runes.size();
+            const int next = cell.col + runes.size();
+            if (spill || !unchanged(cell.col, next)) {
+                drawglyphs(cr, layout, g.attr, g.fg, g.bg, runes, cell);
+                spill = g.attr.wide;
+            } else {
+                spill = false;
+            }
+            cell.col = next;
+        }
+
+        if (known) {
+            std::copy(glyphs.begin() + begin.col, glyphs.begin() + end.col,
+                    shadow.begin() + begin.col);
+        } else if (begin.col == 0 && end.col == cols) {
+            shadow = glyphs;
         }
     }
 
-    drawcursor(cr, layout);
+    // the old cursor is painted over just as its row draws that cell,
+    // so the shadow still holds what's on screen
+    m_lastcur.col = std::clamp(m_lastcur.col, 0, cols - 1);
+    m_lastcur.row = std::clamp(m_lastcur.row, 0, m_term->rows() - 1);
+    if (view.glyph(m_lastcur).attr.wdummy)
+        m_lastcur.col--;
+    rowglyphs(m_lastcur.row, m_lastcur.col, m_lastcur.col + 1);
+    drawcursor(cr, layout, view, glyphs[m_lastcur.col]);
+
+    if (perf::hud())
+        drawhud(cr, layout);
 
     m_surface->flush();
+
+    m_drawn = m_damage.rects();
+    m_damage.clear();
+
+    perf::drawn(perf::clock::now() - start, dirty_rows);
+    return m_drawn;
+}
+
+void RendererImpl::invalidate()
+{
+    for (auto& row : m_shadow)
+        row.clear();
 }
 
 Cell RendererImpl::pxtocell(int x, int y) const
@@ -476,6 +643,15 @@ Cell RendererImpl::pxtocell(int x, int y) const
             std::clamp(col, 0, (m_width / m_cw) - 1)};
 }
 
+void RendererImpl::damage(int x1, int y1, int x2, int y2)
+{
+    x1 = std::max(x1, 0);
+    y1 = std::max(y1, 0);
+    x2 = std::min(x2, m_width);
+    y2 = std::min(y2, m_height);
+    m_damage.add({x1, y1, x2 - x1, y2 - y1});
+}
+
 void RendererImpl::clear(Context& cr, int x1, int y1, int x2, int y2)
 {
     uint32_t color;
@@ -566,6 +742,12 @@ void RendererImpl::drawglyphs(Context& cr, PangoLayout* layout,
     if (cell.row == m_term->rows() - 1)
         clear(cr, winx, winy + m_ch, winx + width, m_height);
 
+    // the cells, and any border cleared beside them
+    damage((cell.col == 0) ? 0 : winx,
+            (cell.row == 0) ? 0 : winy,
+            (cell.col + charlen >= m_term->cols()) ? m_width : winx + width,
+            (cell.row >= m_term->rows() - 1) ? m_height : winy + m_ch);
+
     // clean up the region we want to draw to.
     cr.setSourceColor(bg);
     cr.setOperator(CAIRO_OPERATOR_SOURCE);
@@ -628,24 +810,20 @@ void RendererImpl::drawglyphs(Context& cr, PangoLayout* layout,
     cr.showLayout(layout);
 }
 
-void RendererImpl::drawcursor(Context& cr, PangoLayout* layout)
+void RendererImpl::drawcursor(Context& cr, PangoLayout* layout,
+        const screen::ScreenView& view, const screen::Glyph& og)
 {
     screen::Glyph g{
             .u = ' ',
             .fg = m_term->defbg(),
             .bg = m_term->defcs()};
 
-    auto& cursor = m_term->cursor();
-
-    m_lastcur.col = std::clamp(m_lastcur.col, 0, m_term->cols() - 1);
-    m_lastcur.row = std::clamp(m_lastcur.row, 0, m_term->rows() - 1);
+    auto& cursor = view.cursor();
 
     int curcol = cursor.col;
 
     // adjust position if in dummy
-    if (m_term->glyph(m_lastcur).attr.wdummy)
-        m_lastcur.col--;
-    if (m_term->glyph({cursor.row, curcol}).attr.wdummy)
+    if (view.glyph({cursor.row, curcol}).attr.wdummy)
         curcol--;
 
     auto& sel = m_term->sel();
@@ -653,14 +831,11 @@ void RendererImpl::drawcursor(Context& cr, PangoLayout* layout)
                    sel.alt == m_term->mode()[term::MODE_ALTSCREEN];
 
     // remove the old cursor
-    // making a copy, because we want to reverse it if it's
-    // selected, without modifying the original
-    screen::Glyph og = m_term->glyph(m_lastcur);
-    if (ena_sel && sel.selected(m_lastcur))
-        og.attr.reverse ^= 1;
     drawglyph(cr, layout, og, m_lastcur);
 
-    auto& oldg = m_term->glyph(cursor);
+    const bool cursor_sel = ena_sel && sel.span(cursor.row).contains(cursor.col);
+
+    auto& oldg = view.glyph(cursor);
     g.u = oldg.u;
     g.attr.bold = oldg.attr.bold;
     g.attr.italic = oldg.attr.italic;
@@ -672,7 +847,7 @@ void RendererImpl::drawcursor(Context& cr, PangoLayout* layout)
     if (m_term->mode()[term::MODE_REVERSE]) {
         g.attr.reverse = 1;
         g.bg = m_term->deffg();
-        if (ena_sel && sel.selected(cursor)) {
+        if (cursor_sel) {
             drawcol = m_term->defcs();
             g.fg = m_term->defrcs();
         } else {
@@ -680,7 +855,7 @@ void RendererImpl::drawcursor(Context& cr, PangoLayout* layout)
             g.fg = m_term->defcs();
         }
     } else {
-        if (ena_sel && sel.selected(cursor)) {
+        if (cursor_sel) {
             drawcol = m_term->defrcs();
             g.fg = m_term->deffg();
             g.bg = m_term->defrcs();
@@ -694,14 +869,13 @@ void RendererImpl::drawcursor(Context& cr, PangoLayout* layout)
 
     // draw the new one
     if (m_term->focused()) {
-        switch (m_term->cursortype()) {
+        switch (view.cursortype()) {
             case screen::cursor_type::CURSOR_BLINK_BLOCK:
                 if (m_term->mode()[term::MODE_BLINK])
                     break;
                 [[fallthrough]];
             case screen::cursor_type::CURSOR_STEADY_BLOCK:
-                g.attr.wide = m_term->glyph({cursor.row, curcol})
-                                      .attr.wide;
+                g.attr.wide = view.glyph({cursor.row, curcol}).attr.wide;
                 drawglyph(cr, layout, g, cursor);
                 break;
             case screen::cursor_type::CURSOR_BLINK_UNDER:
@@ -717,6 +891,10 @@ void RendererImpl::drawcursor(Context& cr, PangoLayout* layout)
                         m_cw,
                         cursor_thickness);
                 cr.fill();
+                damage(m_border_px + curcol * m_cw,
+                        m_border_px + cursor.row * m_ch,
+                        m_border_px + (curcol + 1) * m_cw,
+                        m_border_px + (cursor.row + 1) * m_ch);
             } break;
             case screen::cursor_type::CURSOR_BLINK_BAR:
                 if (m_term->mode()[term::MODE_BLINK])
@@ -731,6 +909,10 @@ void RendererImpl::drawcursor(Context& cr, PangoLayout* layout)
                         cursor_thickness,
                         m_ch);
                 cr.fill();
+                damage(m_border_px + curcol * m_cw,
+                        m_border_px + cursor.row * m_ch,
+                        m_border_px + curcol * m_cw + cursor_thickness,
+                        m_border_px + (cursor.row + 1) * m_ch);
             } break;
         }
     } else {
@@ -741,11 +923,58 @@ void RendererImpl::drawcursor(Context& cr, PangoLayout* layout)
                 m_cw - 1,
                 m_ch - 1);
         cr.stroke();
+        damage(m_border_px + curcol * m_cw,
+                m_border_px + cursor.row * m_ch,
+                m_border_px + (curcol + 1) * m_cw,
+                m_border_px + (cursor.row + 1) * m_ch);
     }
 
     m_lastcur = {cursor.row, curcol};
 }
 
+void RendererImpl::drawhud(Context& cr, PangoLayout* layout)
+{
+    const auto& r = perf::rates();
+
+    // fixed width fields, so each frame covers the last
+    std::string cache = "     n/a";
+    if (auto lookups = r.cache_hits + r.cache_misses)
+        cache = fmt::format("{:>7.1f}%", 100.0 * r.cache_hits / lookups);
+
+    const auto text = fmt::format(
+            "fps   {:>6.1f}/{:<6.1f}\n"
+            "frame {:>8.2f} ms\n"
+            "parse {:>8.2f} ms\n"
+            "dirty {:>8.1f} rows\n"
+            "pty   {:>8.1f} KB/s\n"
+            "cache {}",
+            r.fps, r.flushes, r.frame_ms, r.parse_ms, r.dirty_rows,
+            r.pty_bytes / 1024, cache);
+
+    pango_layout_set_attributes(layout, nullptr);
+    pango_layout_set_text(layout, text.c_str(), -1);
+
+    int width, height;
+    pango_layout_get_pixel_size(layout, &width, &height);
+
+    const int pad = m_cw / 2;
+    const int x = m_width - m_border_px - width - 2 * pad;
+    const int y = m_border_px;
+
+    cr.setOperator(CAIRO_OPERATOR_SOURCE);
+    cr.setSourceRgb(0, 0, 0);
+    cr.rectangle(x, y, width + 2 * pad, height + 2 * pad);
+    cr.fill();
+
+    cr.setOperator(CAIRO_OPERATOR_OVER);
+    cr.setSourceRgb(1, 1, 1);
+    cr.moveTo(x + pad, y + pad);
+    cr.showLayout(layout);
+    damage(x, y, x + width + 2 * pad, y + height + 2 * pad);
+
+    m_hudshown = true;
+}
+
 void RendererImpl::load_font(Context& cr)
 {
     auto L = rwte->lua();
@@ -826,9 +1055,15 @@ int Renderer::charheight() const
     return impl->charheight();
 }
 
-void Renderer::drawregion(const Cell& begin, const Cell& end)
+const std::vector<Rect>& Renderer::drawregion(const Cell& begin,
+        const Cell& end)
+{
+    return impl->drawregion(begin, end);
+}
+
+void Renderer::invalidate()
 {
-    impl->drawregion(begin, end);
+    impl->invalidate();
 }
 
 Cell Renderer::pxtocell(int x, int y) const
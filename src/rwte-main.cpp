@@ -1,14 +1,18 @@
 #include "lua/logging.h"
 #include "lua/state.h"
 #include "lua/term.h"
+#include "lua/trace.h"
 #include "lua/window.h"
 #include "rw/argparse.h"
 #include "rw/logging.h"
 #include "rw/utf8.h"
+#include "rwte/asynclog.h"
 #include "rwte/config.h"
 #include "rwte/event.h"
+#include "rwte/perf.h"
 #include "rwte/reactor.h"
 #include "rwte/rwte.h"
+#include "rwte/trace.h"
 #include "rwte/tty.h"
 #include "rwte/version.h"
 #include "rwte/window.h"
@@ -121,6 +125,8 @@ Usage: rwte [options] [-- args]
                         command may be specified after a \"--\"
   -o, --out OUT         writes all io to this file;
                         \"-\" means stdout
+  -r, --record          with -o, writes a timestamped capture
+                        of pty output, for replay in rwte-bench
   -l, --line LINE       use a tty line instead of creating a
                         new pty; LINE is expected to be the
                         device
@@ -181,6 +187,7 @@ int main(int argc, char* argv[])
     register_lualogging(L.get());
     register_luaterm(L.get());
     register_luawindow(L.get());
+    register_luatrace(L.get());
 
     // feed lua our args
     L->newtable();
@@ -208,6 +215,7 @@ int main(int argc, char* argv[])
         .optional(&options.winname, "name"sv, "n"sv)
         .optional(&exec, "exe"sv, "e"sv) // todo: rename exec?
         .optional(&options.io, "out"sv, "o"sv)
+        .optional(&options.record, "record"sv, "r"sv)
         .optional(&options.line, "line"sv, "l"sv)
         .optional(&got_bench, "bench"sv, "b"sv)
         // todo: something constexpr?
@@ -343,6 +351,10 @@ int main(int argc, char* argv[])
 
         tty->open(window.get());
 
+        // after the fork, so the child doesn't queue records with
+        // nothing to write them
+        asynclog::start();
+
         r.set_ttyfd(tty->fd());
         r.set_windowfd(window->fd());
 
@@ -350,7 +362,7 @@ int main(int argc, char* argv[])
             window->prepare();
             bool stop = false;
             std::visit(
-                    [tty, window, &stop](auto&& state) -> void {
+                    [term, tty, window, &stop](auto&& state) -> void {
                         using T = std::decay_t<decltype(state)>;
                         if constexpr (std::is_same_v<T, reactor::TtyRead>) {
                             tty->read_ready();
@@ -365,9 +377,21 @@ int main(int argc, char* argv[])
                             LOGGER()->info("repeatkey");
                         } else if constexpr (std::is_same_v<T, reactor::Blink>) {
                             rwte->blinkcb();
+                        } else if constexpr (std::is_same_v<T, reactor::SyncTimeout>) {
+                            rwte->synccb();
                         } else if constexpr (std::is_same_v<T, reactor::ChildEnd>) {
                             rwte->child_ended();
                             stop = true;
+                        } else if constexpr (std::is_same_v<T, reactor::TraceToggle>) {
+                            // first signal starts tracing, next dumps it
+                            if (!trace::enabled()) {
+                                trace::start();
+                            } else {
+                                trace::stop();
+                                trace::dump(trace::default_path());
+                            }
+                        } else if constexpr (std::is_same_v<T, reactor::StatsDump>) {
+                            perf::log_stats(term->memsize());
                         } else if constexpr (std::is_same_v<T, reactor::Stop>) {
                             stop = true;
                         }
@@ -381,6 +405,8 @@ int main(int argc, char* argv[])
         LOGGER()->error(fmt::format("window error: {}", e.what()));
     }
 
+    asynclog::stop();
+
     LOGGER()->debug("exiting");
     return 0;
 }
@@ -1,6 +1,7 @@
 #include "lua/config.h"
 #include "lua/state.h"
 #include "rw/logging.h"
+#include "rwte/perf.h"
 #include "rwte/reactorctrl.h"
 #include "rwte/rwte.h"
 #include "rwte/term.h"
@@ -33,6 +34,7 @@ lua_State* g_L = nullptr;
 // default values to use if we don't have
 // a default value in config
 constexpr float DEFAULT_BLINK_RATE = 0.6;
+constexpr float DEFAULT_SYNC_TIMEOUT = 0.5;
 
 Rwte::Rwte(std::shared_ptr<event::Bus> bus, reactor::ReactorCtrl* ctrl) :
     m_bus(std::move(bus)),
@@ -50,6 +52,13 @@ Rwte::~Rwte()
 
 void Rwte::refresh()
 {
+    if (m_syncing) {
+        if (!m_sync_pending)
+            perf::held();
+        m_sync_pending = true;
+        return;
+    }
+
     if (options.throttledraw) {
         m_ctrl->queue_refresh(1.0 / 60.0);
     } else {
@@ -78,6 +87,28 @@ void Rwte::stop_blink()
     m_ctrl->stop_blink();
 }
 
+void Rwte::start_sync()
+{
+    // safety net, in case the app never ends the update
+    float timeout = lua::config::get_float(
+            "sync_timeout", DEFAULT_SYNC_TIMEOUT);
+
+    m_syncing = true;
+    m_ctrl->start_sync(timeout);
+}
+
+void Rwte::end_sync()
+{
+    m_ctrl->stop_sync();
+    m_syncing = false;
+
+    // present the whole update as one frame, right away
+    if (m_sync_pending) {
+        m_sync_pending = false;
+        flushcb();
+    }
+}
+
 void Rwte::child_ended()
 {
     // as long as something's exited, reap it
@@ -99,6 +130,15 @@ void Rwte::child_ended()
 
 void Rwte::flushcb()
 {
+    // a refresh queued before the update started
+    if (m_syncing) {
+        perf::held();
+        m_sync_pending = true;
+        return;
+    }
+
+    perf::flushed();
+
     if (auto window = m_window.lock())
         window->draw();
 }
@@ -109,6 +149,17 @@ void Rwte::blinkcb()
         term->blink();
 }
 
+void Rwte::synccb()
+{
+    LOGGER()->warn("synchronized update timed out");
+
+    // let term drop the mode; it'll call back to end_sync
+    if (auto term = m_term.lock())
+        term->endsync();
+    else
+        end_sync();
+}
+
 void Rwte::onrefresh(const event::Refresh& evt)
 {
     refresh();
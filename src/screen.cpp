@@ -1,15 +1,60 @@
 #include "lua/config.h"
-#include "lua/state.h"
 #include "rw/logging.h"
-#include "rw/utf8.h"
-#include "rwte/rwte.h"
+#include "rwte/history.h"
+#include "rwte/reflow.h"
 #include "rwte/screen.h"
 #include "rwte/selection.h"
+#include "rwte/seltext.h"
+#include "rwte/wordclass.h"
+
+#include <chrono>
+#include <deque>
+#include <utility>
+#include <vector>
 
 #define LOGGER() (rw::logging::get("screen"))
 
 namespace screen {
 
+void screenRows::resize(std::size_t n)
+{
+    std::size_t old = m_rows.size();
+    m_rows.resize(n);
+    for (std::size_t i = old; i < n; i++)
+        m_rows[i] = std::make_shared<screenRow>();
+}
+
+void screenRows::erase_front(std::size_t n)
+{
+    n = std::min(n, m_rows.size());
+    m_rows.erase(m_rows.begin(), m_rows.begin() + n);
+}
+
+screenRow& screenRows::operator[](std::size_t i)
+{
+    auto& row = m_rows[i];
+    // a snapshot holds a reference; clone before writing
+    if (row.use_count() > 1)
+        row = std::make_shared<screenRow>(*row);
+    return *row;
+}
+
+static History::Options get_history_options()
+{
+    History::Options opts;
+    opts.max_lines = std::max(lua::config::get_int("scrollback_lines", 0), 0);
+    opts.spill = lua::config::get_bool("scrollback_spill", false);
+    opts.ram_lines = std::max(
+            lua::config::get_int("scrollback_ram_lines", 1000), 0);
+    return opts;
+}
+
+static std::chrono::steady_clock::duration get_alt_keep()
+{
+    return std::chrono::seconds{
+            std::max(lua::config::get_int("alt_screen_keep", 30), 0)};
+}
+
 static cursor_type get_cursor_type()
 {
     auto cursor_type = lua::config::get_string("cursor_type");
@@ -30,23 +75,11 @@ static cursor_type get_cursor_type()
         return cursor_type::CURSOR_STEADY_BLOCK;
 }
 
-static bool isdelim(char32_t c)
+// number of blinking glyphs in [begin, end) of a row
+static int countblink(const screenRow& row, int begin, int end)
 {
-    auto L = rwte->lua();
-    L->getglobal("config");
-    L->getfield(-1, "word_delimiters");
-    auto word_delimiters = L->tostring(-1);
-
-    // if word_delimiters is missing, it'll select whole line
-    // TODO: look to replacing utf8contains with wcschr
-    // (that's what st did)
-    // their default word_delimiters is just " " by default
-    bool delim = false;
-    if (!word_delimiters.empty())
-        delim = c != 0 && utf8contains(word_delimiters, c);
-
-    L->pop(2);
-    return delim;
+    return std::count_if(row.cbegin() + begin, row.cbegin() + end,
+            [](const Glyph& g) { return g.attr.blink; });
 }
 
 class ScreenImpl
@@ -63,56 +96,94 @@ public:
     void reset()
     {
         m_cursortype = get_cursor_type();
+        m_wordclass = WordClass{lua::config::get_string("word_delimiters")};
+        m_altkeep = get_alt_keep();
+
+        // history survives later resets, like xterm's saved lines
+        if (!m_history_configured) {
+            m_history.configure(get_history_options());
+            m_history_configured = true;
+        }
 
         m_top = 0;
         m_bot = m_rows - 1;
 
-        for (int i = 0; i < 2; i++) {
+        // a hidden alternate screen is cleared by releasing it
+        clear();
+        if (m_altshown) {
+            swapscreen();
             clear();
             swapscreen();
-        }
+        } else
+            releasealt(blank());
     }
 
-    void resize(int cols, int rows)
+    // the main screen is reflowed, rewrapping its lines at the new
+    // width; the alternate screen belongs to full screen programs,
+    // which redraw it anyway, so it's only cropped or padded. cells
+    // added by either are set to blank.
+    void resize(int cols, int rows, const Glyph& blank)
     {
-        // slide screen to keep cursor where we expect it
-        if (m_cursor.row - rows >= 0) {
-            LOGGER()->debug("cursor {}, {}", m_cursor.row, m_cursor.col);
-            LOGGER()->debug("removing {} lines for cursor",
-                    (m_cursor.row - rows) + 1);
-            m_lines.erase(m_lines.cbegin(),
-                    m_lines.cbegin() + (m_cursor.row - rows) + 1);
-            m_alt_lines.erase(m_alt_lines.cbegin(),
-                    m_alt_lines.cbegin() + (m_cursor.row - rows) + 1);
-        }
-
-        // resize to new height
-        m_lines.resize(rows);
-        m_alt_lines.resize(rows);
-        m_dirty.resize(rows);
-
-        // resize each row to new width, zero-pad if needed
-        int i;
-        int minrow = std::min(rows, m_rows);
-        for (i = 0; i < minrow; i++) {
-            m_lines[i].resize(cols);
-            m_alt_lines[i].resize(cols);
-        }
+        if (m_altshown) {
+            reflow(m_alt_lines, cols, rows, blank);
+            crop(m_lines, m_cursor, cols, rows, blank);
+        } else {
+            reflow(m_lines, cols, rows, blank);
 
-        // allocate any new rows
-        for (; i < rows; i++) {
-            m_lines[i].resize(cols);
-            m_alt_lines[i].resize(cols);
+            // a blank alternate screen is released rather than resized
+            if (!m_alt_lines.empty() && !releasealt())
+                crop(m_alt_lines, m_stored_cursors[1], cols, rows, blank);
         }
 
         // update terminal size
         m_cols = cols;
         m_rows = rows;
+
+        // rows moved around; recount blinking glyphs from scratch
+        m_blink.assign(rows, 0);
+        m_alt_blink.assign(rows, 0);
+        m_blinktotal = m_alt_blinktotal = 0;
+        for (int i = 0; i < rows; i++) {
+            m_blink[i] = countblink(std::as_const(m_lines)[i], 0, cols);
+            m_blinktotal += m_blink[i];
+            if (!m_alt_lines.empty()) {
+                m_alt_blink[i] = countblink(std::as_const(m_alt_lines)[i], 0, cols);
+                m_alt_blinktotal += m_alt_blink[i];
+            }
+        }
+
+        m_dirty.assign(rows, false);
+        setdirty();
+
+        // the selection's cells were moved by reflow; it can only be
+        // normalized against the new size
+        if (!m_sel.empty() && !m_sel.alt && !m_altshown)
+            selnormalize();
+        else if (!m_sel.alt)
+            m_sel.clear();
+        selupdate();
     }
 
+    // the alternate screen is only allocated while it's used; it's
+    // released once it has been hidden and blank for a while
     void swapscreen()
     {
+        // only the alternate screen is ever released
+        if (m_alt_lines.empty()) {
+            m_alt_lines.resize(m_rows);
+            for (int i = 0; i < m_rows; i++)
+                m_alt_lines[i].assign(m_cols, m_alt_blank);
+        }
+
+        if (m_altshown) {
+            m_althidden = std::chrono::steady_clock::now();
+            m_altidle = true;
+        }
+
+        m_altshown = !m_altshown;
         std::swap(m_lines, m_alt_lines);
+        std::swap(m_blink, m_alt_blink);
+        std::swap(m_blinktotal, m_alt_blinktotal);
         setdirty();
     }
 
@@ -121,6 +192,12 @@ public:
         clear({0, 0}, {m_rows - 1, m_cols - 1});
     }
 
+    // what clear fills cells with
+    Glyph blank() const
+    {
+        return {empty_char, {}, m_cursor.attr.fg, m_cursor.attr.bg};
+    }
+
     // note: includes end
     void clear(const Cell& begin, const Cell& end)
     {
@@ -134,13 +211,7 @@ public:
         if (row1 > row2)
             std::swap(row1, row2);
 
-        Glyph empty{
-                empty_char,
-                {},
-                m_cursor.attr.fg,
-                m_cursor.attr.bg};
-
-        fill({row1, col1}, {row2, col2}, empty);
+        fill({row1, col1}, {row2, col2}, blank());
 
         if (m_sel.anyselected({row1, col1}, {row2, col2}))
             selclear();
@@ -163,7 +234,12 @@ public:
 
     void setGlyph(const Cell& cell, const Glyph& glyph)
     {
-        m_lines[cell.row][cell.col] = glyph;
+        auto& g = m_lines[cell.row][cell.col];
+        int delta = glyph.attr.blink - g.attr.blink;
+        m_blink[cell.row] += delta;
+        m_blinktotal += delta;
+
+        g = glyph;
         m_dirty[cell.row] = true;
 
         m_bus->publish(event::Refresh{});
@@ -184,8 +260,9 @@ public:
     void deleteline(int n)
     {
         // todo: work out what to do for delete 0 (currently broken?)
+        // deleted lines are gone, not scrolled off into history
         if (m_top <= m_cursor.row && m_cursor.row <= m_bot)
-            scrollup(m_cursor.row, n);
+            shiftup(m_cursor.row, n);
     }
 
     void insertblankline(int n)
@@ -205,6 +282,7 @@ public:
 
         auto lineit = m_lines[m_cursor.row].begin();
         std::copy_n(lineit + src, size, lineit + dst);
+        recountblink(m_cursor.row);
         clear({m_cursor.row, m_cols - n}, {m_cursor.row, m_cols - 1});
     }
 
@@ -218,6 +296,7 @@ public:
                     line.begin() + m_cursor.col,
                     line.end() - n,
                     line.end());
+            recountblink(m_cursor.row);
 
             // clear moved area
             clear(m_cursor, {m_cursor.row, m_cursor.col + n - 1});
@@ -236,15 +315,35 @@ public:
         m_bot = b;
     }
 
+    // scrolls lines off the top of the region; those leaving the top
+    // of the main screen go to history
     void scrollup(int orig, int n)
     {
         n = std::clamp(n, 0, m_bot - orig + 1);
 
+        if (orig == 0 && !m_altshown) {
+            for (int i = 0; i < n; i++)
+                m_history.push(std::as_const(m_lines)[i]);
+            if (n > 0)
+                m_bus->publish(event::HistoryPush{});
+            idlealt();
+        }
+
+        shiftup(orig, n);
+    }
+
+    // moves lines up over [orig, orig + n), dropping them
+    void shiftup(int orig, int n)
+    {
+        n = std::clamp(n, 0, m_bot - orig + 1);
+
         clear({orig, 0}, {orig + n - 1, m_cols - 1});
         setdirty(orig + n, m_bot);
 
-        for (int i = orig; i <= m_bot - n; i++)
-            std::swap(m_lines[i], m_lines[i + n]);
+        for (int i = orig; i <= m_bot - n; i++) {
+            m_lines.swap_rows(i, i + n);
+            std::swap(m_blink[i], m_blink[i + n]);
+        }
 
         selscroll(orig, -n);
     }
@@ -256,8 +355,10 @@ public:
         setdirty(orig, m_bot - n);
         clear({m_bot - n + 1, 0}, {m_bot, m_cols - 1});
 
-        for (int i = m_bot; i >= orig + n; i--)
-            std::swap(m_lines[i], m_lines[i - n]);
+        for (int i = m_bot; i >= orig + n; i--) {
+            m_lines.swap_rows(i, i - n);
+            std::swap(m_blink[i], m_blink[i - n]);
+        }
 
         selscroll(orig, n);
     }
@@ -291,15 +392,15 @@ public:
     {
         int newcol, newrow, colt, rowt;
         int delim, prevdelim;
-        Glyph *gp, *prevgp;
+        const Glyph *gp, *prevgp;
 
         switch (m_sel.snap) {
             case Selection::Snap::Word:
                 // Snap around if the word wraps around at the end or
                 // beginning of a line.
 
-                prevgp = &m_lines[*row][*col];
-                prevdelim = isdelim(prevgp->u);
+                prevgp = &std::as_const(m_lines)[*row][*col];
+                prevdelim = m_wordclass.isdelim(prevgp->u);
                 for (;;) {
                     newcol = *col + direction;
                     newrow = *row;
@@ -320,8 +421,8 @@ public:
                     if (newcol >= linelen(newrow))
                         break;
 
-                    gp = &m_lines[newrow][newcol];
-                    delim = isdelim(gp->u);
+                    gp = &std::as_const(m_lines)[newrow][newcol];
+                    delim = m_wordclass.isdelim(gp->u);
                     if (!gp->attr.wdummy &&
                             (delim != prevdelim || (delim && gp->u != prevgp->u)))
                         break;
@@ -363,8 +464,8 @@ public:
         if (m_sel.empty())
             return;
 
-        setdirty(m_sel.nb.row, m_sel.ne.row);
         m_sel.clear();
+        selupdate();
     }
 
     void selscroll(int orig, int n)
@@ -414,63 +515,52 @@ public:
         selsnap(&m_sel.ne.col, &m_sel.ne.row, +1);
 
         // expand selection over line breaks
-        if (m_sel.rectangular())
-            return;
-        int i = linelen(m_sel.nb.row);
-        if (i < m_sel.nb.col)
-            m_sel.nb.col = i;
-        if (linelen(m_sel.ne.row) <= m_sel.ne.col)
-            m_sel.ne.col = m_cols - 1;
+        if (!m_sel.rectangular()) {
+            int i = linelen(m_sel.nb.row);
+            if (i < m_sel.nb.col)
+                m_sel.nb.col = i;
+            if (linelen(m_sel.ne.row) <= m_sel.ne.col)
+                m_sel.ne.col = m_cols - 1;
+        }
+
+        selupdate();
     }
 
-    // todo: move to screen?
-    std::shared_ptr<char> getsel() const
+    // brings the selection's per row spans up to date, dirtying only
+    // the rows whose span changed
+    void selupdate()
     {
-        // todo: refactor these?
-        char *str, *ptr;
-        int row, bufsize, lastcol, llen;
-        const screen::Glyph *gp, *last;
+        m_selchanged.clear();
+        m_sel.updatespans(m_rows, m_cols, m_selchanged);
+        if (m_selchanged.empty())
+            return;
 
+        for (int row : m_selchanged)
+            m_dirty[row] = true;
+        m_bus->publish(event::Refresh{});
+    }
+
+    // the selected text, read from the rows as they are now
+    std::shared_ptr<const SelectionText> getsel() const
+    {
         if (m_sel.empty())
             return nullptr;
 
-        bufsize = (m_cols + 1) * (m_sel.ne.row - m_sel.nb.row + 1) * utf_size;
-        // todo: look at using std::array or vector instead, w/ move
-        ptr = str = new char[bufsize];
-
-        // append every set & selected glyph to the selection
-        for (row = m_sel.nb.row; row <= m_sel.ne.row; row++) {
-            if ((llen = linelen(row)) == 0) {
-                *ptr++ = '\n';
-                continue;
-            }
-
-            if (m_sel.rectangular()) {
-                gp = &glyph({row, m_sel.nb.col});
-                lastcol = m_sel.ne.col;
-            } else {
-                gp = &glyph({row, m_sel.nb.row == row ? m_sel.nb.col : 0});
-                lastcol = (m_sel.ne.row == row) ? m_sel.ne.col : m_cols - 1;
-            }
-            last = &glyph({row, std::min(lastcol, llen - 1)});
-            while (last >= gp && last->u == screen::empty_char)
-                --last;
-
-            for (; gp <= last; ++gp) {
-                if (gp->attr.wdummy)
-                    continue;
-
-                ptr = utf8encode(gp->u, ptr);
-            }
-
-            // use \n for line ending in outgoing data
-            if ((row < m_sel.ne.row || lastcol >= llen) &&
-                    !last->attr.wrap)
-                *ptr++ = '\n';
-        }
-        *ptr = 0;
-
-        return std::shared_ptr<char>(str, std::default_delete<char[]>());
+        // ends off the screen are cut back to it
+        Cell nb = m_sel.nb;
+        Cell ne = m_sel.ne;
+        if (nb.row < 0)
+            nb = {0, 0};
+        if (ne.row >= m_rows)
+            ne = {m_rows - 1, m_cols - 1};
+
+        std::vector<std::shared_ptr<const screenRow>> rows;
+        rows.reserve(std::max(ne.row - nb.row + 1, 0));
+        for (int row = nb.row; row <= ne.row; row++)
+            rows.push_back(m_lines.ptr(row));
+
+        return std::make_shared<const SelectionText>(std::move(rows), m_cols,
+                nb, ne, m_sel.rectangular());
     }
 
     int linelen(int row) const
@@ -486,6 +576,28 @@ public:
         return i;
     }
 
+    int blinkcount() const { return m_blinktotal; }
+    int blinkcount(int row) const { return m_blink[row]; }
+
+    std::size_t memsize() const
+    {
+        // rows shared with a snapshot are counted once per screen
+        std::size_t size = sizeof(*this);
+        for (const auto* lines : {&m_lines, &m_alt_lines}) {
+            for (std::size_t i = 0; i < lines->size(); i++) {
+                size += sizeof(screenRow) +
+                        (*lines)[i].capacity() * sizeof(Glyph);
+            }
+        }
+        size += (m_blink.capacity() + m_alt_blink.capacity()) * sizeof(int);
+        size += m_dirty.capacity() / 8;
+        return size + m_history.memsize();
+    }
+
+    History& history() { return m_history; }
+    const History& history() const { return m_history; }
+    void clearhistory() { m_history.clear(); }
+
     bool isdirty(int row) const { return m_dirty[row]; }
     void setdirty() { setdirty(0, m_rows - 1); }
     void cleardirty(int row) { m_dirty[row] = false; }
@@ -508,6 +620,18 @@ public:
     screenRow& line(int row) { return m_lines[row]; }
     const screenRow& line(int row) const { return m_lines[row]; }
 
+    ScreenView snapshot() const
+    {
+        ScreenView view;
+        view.m_lines.reserve(m_lines.size());
+        for (std::size_t i = 0; i < m_lines.size(); i++)
+            view.m_lines.push_back(m_lines.ptr(i));
+        view.m_cols = m_cols;
+        view.m_cursor = m_cursor;
+        view.m_cursortype = m_cursortype;
+        return view;
+    }
+
     const int rows() const { return m_rows; }
     const int cols() const { return m_cols; }
     const int top() const { return m_top; }
@@ -539,11 +663,217 @@ public:
     const Selection& sel() const { return m_sel; }
 
 private:
+    // releases the hidden alternate screen if it's all blank, to be
+    // allocated again, filled with the same blank, when it's next
+    // shown. returns whether it was released.
+    bool releasealt()
+    {
+        if (m_altshown || m_alt_lines.empty())
+            return false;
+
+        const Glyph first = std::as_const(m_alt_lines)[0][0];
+        if (first.u != empty_char || first.attr != glyph_attribute{})
+            return false;
+
+        for (int i = 0; i < static_cast<int>(m_alt_lines.size()); i++) {
+            const auto& row = std::as_const(m_alt_lines)[i];
+            if (std::any_of(row.begin(), row.end(), [&](const Glyph& g) {
+                    return g.u != first.u || g.attr != first.attr ||
+                           g.fg != first.fg || g.bg != first.bg;
+                }))
+                return false;
+        }
+
+        releasealt(first);
+        return true;
+    }
+
+    void releasealt(const Glyph& blank)
+    {
+        m_alt_lines.resize(0);
+        m_alt_blank = blank;
+        m_altidle = false;
+        std::fill(m_alt_blink.begin(), m_alt_blink.end(), 0);
+        m_alt_blinktotal = 0;
+    }
+
+    // releases the alternate screen once it's been hidden long
+    // enough. if it isn't blank, it's kept until it's next hidden.
+    void idlealt()
+    {
+        if (m_altidle &&
+                std::chrono::steady_clock::now() - m_althidden >= m_altkeep) {
+            m_altidle = false;
+            releasealt();
+        }
+    }
+
+    // crops or pads lines to the new size, sliding them up if needed
+    // to keep the cursor on screen
+    void crop(screenRows& lines, const Cursor& cursor, int cols, int rows,
+            const Glyph& blank)
+    {
+        if (cursor.row >= rows)
+            lines.erase_front(cursor.row - rows + 1);
+
+        const int old = lines.size();
+        lines.resize(rows);
+        for (int i = 0; i < rows; i++) {
+            if (i < old)
+                lines[i].resize(cols, blank);
+            else
+                lines[i].assign(cols, blank);
+        }
+    }
+
+    // rewraps the main screen's lines to the new width. the line
+    // running onto the top row is pulled back out of history, as are
+    // more lines if the screen was full and now has room; anything
+    // pushed above the top goes to history. the cursors and the
+    // selection move with their text.
+    void reflow(screenRows& lines, int cols, int rows, const Glyph& blank)
+    {
+        const bool shown = !m_altshown;
+
+        // points to follow; the saved cursor, the cursor if this is
+        // the screen it's on, then the selection's ends
+        std::vector<Cell> points{m_stored_cursors[0]};
+        if (shown)
+            points.push_back(m_cursor);
+
+        if (!m_sel.empty() && !m_sel.alt && (!shown || m_sel.rectangular()))
+            m_sel.clear(); // can't be kept sensibly
+        if (!m_sel.empty() && !m_sel.alt) {
+            // clamp to the row's text, so the selection can't lengthen
+            // its lines
+            for (auto cell : {m_sel.ob, m_sel.oe}) {
+                cell.col = std::clamp(cell.col, 0,
+                        std::max(linelen(cell.row) - 1, 0));
+                points.push_back(cell);
+            }
+        }
+
+        // rows in use: through the last with text, and any points
+        int used = 0;
+        for (int i = 0; i < static_cast<int>(lines.size()); i++) {
+            const auto& line = std::as_const(lines)[i];
+            if (std::any_of(line.begin(), line.end(),
+                        [](const Glyph& g) { return g.u != empty_char; }))
+                used = i + 1;
+        }
+        for (const auto& pt : points)
+            used = std::max(used, pt.row + 1);
+        used = std::min<int>(used, lines.size());
+
+        // lines pulled back out of history, oldest first
+        std::deque<screenRow> pulled;
+        screenRow row;
+        auto wrapped = [&]() {
+            return m_history.lineat(m_history.total() - 1, row) &&
+                   !row.empty() && row.back().attr.wrap;
+        };
+        auto pull = [&]() {
+            m_history.pop(row);
+            pulled.push_front(std::move(row));
+        };
+
+        while (wrapped())
+            pull();
+
+        // a full screen is kept full from history, a line at a time
+        if (used == m_rows && m_rows > 0) {
+            std::vector<const screenRow*> src;
+            for (auto& r : pulled)
+                src.push_back(&r);
+            for (int i = 0; i < used; i++)
+                src.push_back(&std::as_const(lines)[i]);
+
+            auto shifted = points;
+            for (auto& pt : shifted)
+                pt.row += pulled.size();
+
+            int n = reflowrows(src, cols, shifted);
+            std::vector<const screenRow*> line;
+            while (n < rows && m_history.size()) {
+                const auto before = pulled.size();
+                pull();
+                while (wrapped())
+                    pull();
+
+                line.clear();
+                for (std::size_t i = 0; i < pulled.size() - before; i++)
+                    line.push_back(&pulled[i]);
+                n += reflowrows(line, cols, {});
+            }
+        }
+
+        std::vector<const screenRow*> src;
+        src.reserve(pulled.size() + used);
+        for (auto& r : pulled)
+            src.push_back(&r);
+        for (int i = 0; i < used; i++)
+            src.push_back(&std::as_const(lines)[i]);
+        for (auto& pt : points)
+            pt.row += pulled.size();
+
+        auto out = screen::reflow(src, cols, blank, points);
+
+        // keep the cursor on screen, moving whatever's above the top
+        // into history
+        const int cursor_row = points[shown ? 1 : 0].row;
+        const int top = std::max(cursor_row - rows + 1, 0);
+        for (int i = 0; i < top; i++)
+            m_history.push(std::as_const(out)[i]);
+        if (top > 0)
+            m_bus->publish(event::HistoryPush{});
+
+        const int old = out.size();
+        out.erase_front(top);
+        out.resize(rows);
+        for (int i = std::max(old - top, 0); i < rows; i++)
+            out[i].assign(cols, blank);
+        lines = std::move(out);
+
+        for (auto& pt : points)
+            pt.row -= top;
+
+        auto place = [&](Cursor& cursor, const Cell& pt) {
+            cursor.row = std::clamp(pt.row, 0, rows - 1);
+            cursor.col = std::clamp(pt.col, 0, cols - 1);
+            // a pending wrap only makes sense at the last column
+            if ((cursor.state & CURSOR_WRAPNEXT) && cursor.col < cols - 1) {
+                cursor.col++;
+                cursor.state &= ~CURSOR_WRAPNEXT;
+            }
+        };
+        place(m_stored_cursors[0], points[0]);
+        if (shown)
+            place(m_cursor, points[1]);
+
+        if (!m_sel.empty() && !m_sel.alt) {
+            const auto& ob = points[points.size() - 2];
+            const auto& oe = points[points.size() - 1];
+            if (ob.row < 0 || oe.row >= rows) {
+                m_sel.clear();
+            } else {
+                m_sel.ob = ob;
+                m_sel.oe = oe;
+            }
+        }
+    }
+
     void fill(const Cell& begin, const Cell& end, const Glyph& val)
     {
         // note: assumes caller normalizes begin/end
 
+        int width = end.col - begin.col + 1;
         for (int row = begin.row; row <= end.row; row++) {
+            int delta = (val.attr.blink ? width : 0) -
+                        countblink(std::as_const(m_lines)[row],
+                                begin.col, end.col + 1);
+            m_blink[row] += delta;
+            m_blinktotal += delta;
+
             auto lineit = m_lines[row].begin();
             std::fill(lineit + begin.col, lineit + end.col + 1, val);
 
@@ -553,12 +883,34 @@ private:
         m_bus->publish(event::Refresh{});
     }
 
+    void recountblink(int row)
+    {
+        int n = countblink(std::as_const(m_lines)[row], 0, m_cols);
+        m_blinktotal += n - m_blink[row];
+        m_blink[row] = n;
+    }
+
     std::shared_ptr<event::Bus> m_bus;
     screenRows m_lines;     // screen
-    screenRows m_alt_lines; // alternate screen
+    screenRows m_alt_lines; // alternate screen; empty when released
+
+    Glyph m_alt_blank;       // cells of the released alternate screen
+    bool m_altidle = false;  // whether the hidden alt screen may be released
+    std::chrono::steady_clock::time_point m_althidden; // when it was hidden
+    std::chrono::steady_clock::duration m_altkeep{};   // kept that long
 
     std::vector<bool> m_dirty; // dirtyness of lines
 
+    // blinking glyph counts, per row and per screen. these are kept
+    // current by setGlyph, fill and the scroll/shift helpers; writes
+    // made directly through glyph() or line() are not counted.
+    std::vector<int> m_blink, m_alt_blink;
+    int m_blinktotal = 0, m_alt_blinktotal = 0;
+
+    bool m_altshown = false; // whether m_lines is the alt screen
+    History m_history;       // lines scrolled off the main screen
+    bool m_history_configured = false;
+
     int m_rows, m_cols; // size
     int m_top, m_bot;   // scroll limits
 
@@ -567,6 +919,8 @@ private:
     cursor_type m_cursortype;
 
     Selection m_sel;
+    std::vector<int> m_selchanged; // scratch for selupdate
+    WordClass m_wordclass;         // for snapping to words
 };
 
 Screen::Screen(std::shared_ptr<event::Bus> bus) :
@@ -580,9 +934,9 @@ void Screen::reset()
     impl->reset();
 }
 
-void Screen::resize(int cols, int rows)
+void Screen::resize(int cols, int rows, const Glyph& blank)
 {
-    impl->resize(cols, rows);
+    impl->resize(cols, rows, blank);
 }
 
 void Screen::swapscreen()
@@ -612,7 +966,9 @@ Glyph& Screen::glyph(const Cell& cell)
 
 const Glyph& Screen::glyph(const Cell& cell) const
 {
-    return impl->glyph(cell);
+    // impl isn't const here; go through the const overload so
+    // reads don't detach shared rows
+    return std::as_const(*impl).glyph(cell);
 }
 
 void Screen::setGlyph(const Cell& cell, const Glyph& glyph)
@@ -690,7 +1046,12 @@ void Screen::selnormalize()
     impl->selnormalize();
 }
 
-std::shared_ptr<char> Screen::getsel() const
+void Screen::selupdate()
+{
+    impl->selupdate();
+}
+
+std::shared_ptr<const SelectionText> Screen::getsel() const
 {
     return impl->getsel();
 }
@@ -700,6 +1061,36 @@ int Screen::linelen(int row) const
     return impl->linelen(row);
 }
 
+int Screen::blinkcount() const
+{
+    return impl->blinkcount();
+}
+
+int Screen::blinkcount(int row) const
+{
+    return impl->blinkcount(row);
+}
+
+std::size_t Screen::memsize() const
+{
+    return impl->memsize();
+}
+
+History& Screen::history()
+{
+    return impl->history();
+}
+
+const History& Screen::history() const
+{
+    return std::as_const(*impl).history();
+}
+
+void Screen::clearhistory()
+{
+    impl->clearhistory();
+}
+
 bool Screen::isdirty(int row) const
 {
     return impl->isdirty(row);
@@ -727,7 +1118,7 @@ screenRows& Screen::lines()
 
 const screenRows& Screen::lines() const
 {
-    return impl->lines();
+    return std::as_const(*impl).lines();
 }
 
 screenRow& Screen::line(int row)
@@ -737,7 +1128,12 @@ screenRow& Screen::line(int row)
 
 const screenRow& Screen::line(int row) const
 {
-    return impl->line(row);
+    return std::as_const(*impl).line(row);
+}
+
+ScreenView Screen::snapshot() const
+{
+    return impl->snapshot();
 }
 
 const int Screen::rows() const
@@ -0,0 +1,242 @@
+#include "rw/utf8.h"
+#include "rwte/history.h"
+#include "rwte/search.h"
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+namespace search {
+
+// history lines scanned per pass, between checks for a new pattern
+constexpr std::size_t scan_chunk = 4096;
+
+static char fold(char c)
+{
+    return ('A' <= c && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+void findrow(const screen::screenRow& row, const std::string& pattern,
+        std::size_t line, std::vector<Match>& out)
+{
+    if (pattern.empty())
+        return;
+
+    const bool nocase = std::none_of(pattern.begin(), pattern.end(),
+            [](char c) { return 'A' <= c && c <= 'Z'; });
+
+    // the row as utf8, with the cell each byte came from; reused
+    // across calls, since this runs for every line scanned
+    thread_local std::string text;
+    thread_local std::vector<int> cols;
+    text.clear();
+    cols.clear();
+
+    std::array<char, utf_size> c;
+    for (std::size_t col = 0; col < row.size(); col++) {
+        const auto& g = row[col];
+        if (g.attr.wdummy)
+            continue;
+
+        auto end = utf8encode(g.u, c.begin());
+        for (auto p = c.begin(); p != end; ++p) {
+            text.push_back(nocase ? fold(*p) : *p);
+            cols.push_back(col);
+        }
+    }
+
+    // memmem is vectorized in glibc, and does the heavy lifting
+    std::size_t pos = 0;
+    while (pos + pattern.size() <= text.size()) {
+        auto found = static_cast<const char*>(memmem(text.data() + pos,
+                text.size() - pos, pattern.data(), pattern.size()));
+        if (!found)
+            break;
+
+        std::size_t begin = found - text.data();
+        std::size_t end = begin + pattern.size();
+        int endcol = end < text.size() ? cols[end] : row.size();
+        out.push_back({line, cols[begin], endcol - cols[begin]});
+
+        pos = end;
+    }
+}
+
+static bool before(const Match& a, const Match& b)
+{
+    return std::tie(a.line, a.col) < std::tie(b.line, b.col);
+}
+
+class SearchImpl
+{
+public:
+    explicit SearchImpl(const screen::History& history) :
+        m_history(history)
+    {}
+
+    ~SearchImpl()
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    void start(std::string pattern)
+    {
+        {
+            std::lock_guard lock{m_mutex};
+            m_pattern = std::move(pattern);
+            m_gen++;
+            m_matches.clear();
+            m_scanned = m_history.first();
+        }
+
+        if (!m_thread.joinable() && !m_pattern.empty())
+            m_thread = std::thread{&SearchImpl::run, this};
+        m_wake.notify_one();
+    }
+
+    void pushed()
+    {
+        if (m_pattern.empty())
+            return;
+
+        // the scan reads total under the lock, so taking it here
+        // means it's either seen the new lines or is waiting
+        { std::lock_guard lock{m_mutex}; }
+        m_wake.notify_one();
+    }
+
+    // only changed by start, on the caller's thread
+    const std::string& pattern() const { return m_pattern; }
+
+    std::size_t count() const
+    {
+        std::lock_guard lock{m_mutex};
+        return m_matches.size();
+    }
+
+    std::optional<Match> find(std::size_t line, int col, int dir) const;
+
+private:
+    void run();
+
+    const screen::History& m_history;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::string m_pattern;
+    uint64_t m_gen = 0;           // bumped for each new pattern
+    std::vector<Match> m_matches; // sorted, as lines are scanned in order
+    std::size_t m_scanned = 0;    // next history line to scan
+    bool m_stopping = false;
+
+    std::thread m_thread;
+};
+
+std::optional<Match> SearchImpl::find(std::size_t line, int col,
+        int dir) const
+{
+    std::lock_guard lock{m_mutex};
+    const Match pos{line, col, 0};
+    const auto first = m_history.first();
+
+    if (dir < 0) {
+        auto it = std::lower_bound(m_matches.begin(), m_matches.end(), pos,
+                before);
+        if (it == m_matches.begin() || std::prev(it)->line < first)
+            return {};
+        return *std::prev(it);
+    } else {
+        auto it = std::upper_bound(m_matches.begin(), m_matches.end(), pos,
+                before);
+        while (it != m_matches.end() && it->line < first)
+            ++it;
+        if (it == m_matches.end())
+            return {};
+        return *it;
+    }
+}
+
+void SearchImpl::run()
+{
+    screen::screenRow row;
+    std::vector<Match> found;
+
+    std::unique_lock lock{m_mutex};
+    while (!m_stopping) {
+        const auto total = m_history.total();
+        if (m_pattern.empty() || m_scanned >= total) {
+            // nothing new; start or pushed will wake us
+            m_wake.wait(lock);
+            continue;
+        }
+
+        const auto pattern = m_pattern;
+        const auto gen = m_gen;
+        const auto from = std::max(m_scanned, m_history.first());
+        const auto to = std::min(from + scan_chunk, total);
+        lock.unlock();
+
+        found.clear();
+        for (auto n = from; n < to; n++) {
+            if (m_history.lineat(n, row))
+                findrow(row, pattern, n, found);
+        }
+
+        lock.lock();
+        if (gen != m_gen)
+            continue; // pattern changed while scanning
+
+        // forget matches on lines the history has since dropped
+        const auto first = m_history.first();
+        auto dropped = std::find_if(m_matches.begin(), m_matches.end(),
+                [&](const Match& m) { return m.line >= first; });
+        m_matches.erase(m_matches.begin(), dropped);
+
+        m_matches.insert(m_matches.end(), found.begin(), found.end());
+        m_scanned = to;
+    }
+}
+
+Search::Search(const screen::History& history) :
+    impl(std::make_unique<SearchImpl>(history))
+{}
+
+Search::~Search() = default;
+
+void Search::start(std::string pattern)
+{
+    impl->start(std::move(pattern));
+}
+
+void Search::pushed()
+{
+    impl->pushed();
+}
+
+const std::string& Search::pattern() const
+{
+    return impl->pattern();
+}
+
+std::size_t Search::count() const
+{
+    return impl->count();
+}
+
+std::optional<Match> Search::find(std::size_t line, int col, int dir) const
+{
+    return impl->find(line, col, dir);
+}
+
+} // namespace search
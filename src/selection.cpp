@@ -1,6 +1,8 @@
 #include "rwte/selection.h"
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
 
 void Selection::clear()
 {
@@ -26,12 +28,11 @@ bool Selection::anyselected(const Cell& begin, const Cell& end) const
     if (empty())
         return false;
 
-    // todo: make this not dumb
-    Cell cell;
-    for (cell.row = begin.row; cell.row <= end.row; cell.row++)
-        for (cell.col = begin.col; cell.col <= end.col; cell.col++)
-            if (selected(cell))
-                return true;
+    for (int row = begin.row; row <= end.row; row++) {
+        auto span = rowspan(row, std::numeric_limits<int>::max());
+        if (span.begin <= end.col && begin.col < span.end)
+            return true;
+    }
 
     return false;
 }
@@ -49,3 +50,44 @@ bool Selection::selected(const Cell& cell) const
            (cell.row != nb.row || cell.col >= nb.col) &&
            (cell.row != ne.row || cell.col <= ne.col);
 }
+
+Selection::Span Selection::rowspan(int row, int cols) const
+{
+    Span span;
+    if (empty() || row < nb.row || ne.row < row)
+        return span;
+
+    if (m_rectangular) {
+        span = {nb.col, ne.col + 1};
+    } else {
+        span.begin = row == nb.row ? nb.col : 0;
+        span.end = row == ne.row ? ne.col + 1 : cols;
+    }
+
+    span.begin = std::clamp(span.begin, 0, cols);
+    span.end = std::clamp(span.end, span.begin, cols);
+    if (span.empty())
+        span = {};
+    return span;
+}
+
+void Selection::updatespans(int rows, int cols, std::vector<int>& changed)
+{
+    m_spans.resize(rows);
+
+    for (int row = 0; row < rows; row++) {
+        auto span = rowspan(row, cols);
+        if (span != m_spans[row]) {
+            m_spans[row] = span;
+            changed.push_back(row);
+        }
+    }
+}
+
+const Selection::Span& Selection::span(int row) const
+{
+    static const Span none;
+    if (row < 0 || row >= static_cast<int>(m_spans.size()))
+        return none;
+    return m_spans[row];
+}
@@ -0,0 +1,104 @@
+#include "rw/utf8.h"
+#include "rwte/seltext.h"
+
+#include <algorithm>
+#include <array>
+
+namespace screen {
+
+SelectionText::SelectionText(std::vector<std::shared_ptr<const screenRow>> rows,
+        int cols, const Cell& nb, const Cell& ne, bool rectangular) :
+    m_rows(std::make_shared<const std::vector<std::shared_ptr<const screenRow>>>(
+            std::move(rows))),
+    m_cols(cols),
+    m_nb(nb),
+    m_ne(ne),
+    m_rectangular(rectangular)
+{}
+
+SelectionText::Range SelectionText::range(std::size_t i) const
+{
+    const auto& row = *(*m_rows)[i];
+    const int rownum = m_nb.row + i;
+    const int cols = std::min<int>(m_cols, row.size());
+
+    // length of the row's text; the whole row if it wraps
+    int llen = cols;
+    if (llen > 0 && !row[llen - 1].attr.wrap) {
+        while (llen > 0 && row[llen - 1].u == empty_char)
+            --llen;
+    }
+    if (llen == 0)
+        return {0, -1, true};
+
+    int first, lastcol;
+    if (m_rectangular) {
+        first = m_nb.col;
+        lastcol = m_ne.col;
+    } else {
+        first = m_nb.row == rownum ? m_nb.col : 0;
+        lastcol = m_ne.row == rownum ? m_ne.col : cols - 1;
+    }
+
+    int last = std::min(lastcol, llen - 1);
+    while (last >= first && row[last].u == empty_char)
+        --last;
+
+    // use \n for line ending in outgoing data
+    const bool wrapped = last >= 0 && row[last].attr.wrap;
+    return {first, last, (rownum < m_ne.row || lastcol >= llen) && !wrapped};
+}
+
+bool SelectionText::read(std::string& out, std::size_t max)
+{
+    const auto start = out.size();
+    const auto limit = start + max;
+    auto fits = [&](std::size_t n) {
+        return out.size() == start || out.size() + n <= limit;
+    };
+
+    std::array<char, utf_size> buf;
+    for (; m_row < m_rows->size(); m_row++, m_col = -1) {
+        const auto& row = *(*m_rows)[m_row];
+        const auto r = range(m_row);
+
+        if (m_col < 0)
+            m_col = r.first;
+        for (; m_col <= r.last; m_col++) {
+            const auto& g = row[m_col];
+            if (g.attr.wdummy)
+                continue;
+
+            auto end = utf8encode(g.u, buf.begin());
+            if (!fits(end - buf.begin()))
+                return true;
+            out.append(buf.begin(), end);
+        }
+
+        if (r.newline) {
+            if (!fits(1))
+                return true;
+            out.push_back('\n');
+        }
+    }
+
+    return false;
+}
+
+void SelectionText::rewind()
+{
+    m_row = 0;
+    m_col = -1;
+}
+
+std::string SelectionText::str() const
+{
+    auto copy = *this;
+    copy.rewind();
+
+    std::string text;
+    copy.read(text, std::string::npos);
+    return text;
+}
+
+} // namespace screen
@@ -4,12 +4,17 @@
 #include "lua/window.h"
 #include "rw/logging.h"
 #include "rw/utf8.h"
+#include "rwte/asynclog.h"
 #include "rwte/color.h"
 #include "rwte/config.h"
+#include "rwte/history.h"
+#include "rwte/perf.h"
 #include "rwte/rwte.h"
 #include "rwte/screen.h"
+#include "rwte/search.h"
 #include "rwte/selection.h"
 #include "rwte/term.h"
+#include "rwte/trace.h"
 #include "rwte/tty.h"
 #include "rwte/window.h"
 
@@ -17,7 +22,10 @@
 #include <cassert>
 #include <charconv>
 #include <chrono>
+#include <optional>
 #include <string_view>
+#include <tuple>
+#include <utility>
 
 using namespace std::literals;
 
@@ -147,9 +155,9 @@ static int32_t hexcolor(std::string_view src)
         if (np == src.data() + 7)
             idx = 1 << 24 | val;
         else
-            LOGGER()->error("erresc: invalid hex color ({})", src);
+            asynclog::error(LOGGER(), "erresc: invalid hex color ({})", src);
     } else
-        LOGGER()->error("erresc: short hex color ({})", src);
+        asynclog::error(LOGGER(), "erresc: short hex color ({})", src);
 
     return idx;
 }
@@ -163,7 +171,7 @@ static uint32_t defcolor(const int* attr, std::size_t* npar, std::size_t l)
     switch (attr[*npar + 1]) {
         case 2: // direct color in RGB space
             if (*npar + 4 >= l) {
-                LOGGER()->error("erresc(38): Incorrect number of parameters ({})", *npar);
+                asynclog::error(LOGGER(), "erresc(38): Incorrect number of parameters ({})", *npar);
                 break;
             }
             r = attr[*npar + 2];
@@ -171,18 +179,18 @@ static uint32_t defcolor(const int* attr, std::size_t* npar, std::size_t l)
             b = attr[*npar + 4];
             *npar += 4;
             if (!(0 <= r && r <= 255) || !(0 <= g && g <= 255) || !(0 <= b && b <= 255))
-                LOGGER()->error("erresc: bad rgb color ({},{},{})", r, g, b);
+                asynclog::error(LOGGER(), "erresc: bad rgb color ({},{},{})", r, g, b);
             else
                 idx = color::truecol(r, g, b);
             break;
         case 5: // indexed color
             if (*npar + 2 >= l) {
-                LOGGER()->error("erresc(38): Incorrect number of parameters ({})", *npar);
+                asynclog::error(LOGGER(), "erresc(38): Incorrect number of parameters ({})", *npar);
                 break;
             }
             *npar += 2;
             if (!(0 <= attr[*npar] && attr[*npar] <= 255))
-                LOGGER()->error("erresc: bad fgcolor {}", attr[*npar]);
+                asynclog::error(LOGGER(), "erresc: bad fgcolor {}", attr[*npar]);
             else
                 idx = attr[*npar];
             break;
@@ -191,7 +199,7 @@ static uint32_t defcolor(const int* attr, std::size_t* npar, std::size_t l)
         case 3: /* direct color in CMY space */
         case 4: /* direct color in CMYK space */
         default:
-            LOGGER()->error("erresc(38): gfx attr {} unknown", attr[*npar]);
+            asynclog::error(LOGGER(), "erresc(38): gfx attr {} unknown", attr[*npar]);
             break;
     }
 
@@ -224,15 +232,25 @@ public:
     const term_mode& mode() const { return m_mode; }
 
     void blink();
+    void endsync();
 
     const Selection& sel() const { return m_screen.sel(); }
     const screen::Cursor& cursor() const { return m_screen.cursor(); }
     screen::cursor_type cursortype() const { return m_screen.cursortype(); }
+    screen::ScreenView snapshot() const { return m_screen.snapshot(); }
 
     bool isdirty(int row) const { return m_screen.isdirty(row); }
     void setdirty() { m_screen.setdirty(0, m_screen.rows() - 1); }
     void cleardirty(int row) { m_screen.cleardirty(row); }
 
+    std::size_t memsize() const { return m_screen.memsize(); }
+
+    void search(std::string_view pattern);
+    bool searchstep(int dir, search::Match& match);
+    bool searchcurrent(search::Match& match) const;
+    const std::string& searchpattern() const { return m_search.pattern(); }
+    std::size_t searchbase() const { return m_screen.history().total(); }
+
     void putc(char32_t u);
     void mousereport(const Cell& cell, mouse_event_enum evt, int button,
             const keymod_state& mod);
@@ -253,9 +271,11 @@ public:
     void clipcopy();
 
     void send(std::string_view data);
+    void pastecancel();
 
 private:
     void onresize(const event::Resize& evt);
+    void onhistorypush(const event::HistoryPush& evt);
     void resizeCore(int cols, int rows);
     void start_blink();
 
@@ -275,21 +295,26 @@ private:
     void puttab(int n);
     void strparse();
     void strhandle();
-    std::string strdump();
+    std::string_view strbytes() const;
+    std::string strdump() const;
     void strsequence(unsigned char c);
     void csiparse();
     void csihandle();
-    std::string csidump();
+    std::string csidump() const;
     // todo: std::span when c++ 20
     void setattr(const int* attr, std::size_t len);
     // todo: std::span when c++ 20
     void settmode(bool priv, bool set, const int* args, int narg);
+    int modestate(bool priv, int mode) const;
     void getbuttoninfo(const Cell& cell, const keymod_state& mod);
 
     std::shared_ptr<event::Bus> m_bus;
     int m_resizeReg;
 
     screen::Screen m_screen;
+    search::Search m_search;
+    int m_historyReg; // after m_search, which it feeds
+    std::optional<search::Match> m_searchcur; // current search match
     std::weak_ptr<Window> m_window;
     std::weak_ptr<Tty> m_tty;
 
@@ -302,6 +327,7 @@ private:
     int m_charset;  // current charset
     int m_icharset; // selected charset for sequence
     bool m_focused; // whether terminal has focus
+    bool m_blinking; // whether the blink timer is armed
 
     std::array<char, 4> m_trantbl;                // charset table translation
     uint32_t m_deffg, m_defbg, m_defcs, m_defrcs; // default colors
@@ -311,7 +337,10 @@ TermImpl::TermImpl(std::shared_ptr<event::Bus> bus, int cols, int rows) :
     m_bus(std::move(bus)),
     m_resizeReg(m_bus->reg<event::Resize, TermImpl, &TermImpl::onresize>(this)),
     m_screen(m_bus),
-    m_focused(false)
+    m_search(m_screen.history()),
+    m_historyReg(m_bus->reg<event::HistoryPush, TermImpl, &TermImpl::onhistorypush>(this)),
+    m_focused(false),
+    m_blinking(false)
 {
     // only a few things are initialized here
     // the rest happens in resize and reset
@@ -323,6 +352,7 @@ TermImpl::TermImpl(std::shared_ptr<event::Bus> bus, int cols, int rows) :
 TermImpl::~TermImpl()
 {
     m_bus->unreg<event::Resize>(m_resizeReg);
+    m_bus->unreg<event::HistoryPush>(m_historyReg);
 }
 
 void TermImpl::reset()
@@ -379,6 +409,9 @@ void TermImpl::reset()
             m_tabs[i] = true;
     }
 
+    // release anything held by a synchronized update
+    endsync();
+
     // if set, print survives a reset,
     // and we always have wrap and utf8
     // enabled
@@ -420,14 +453,13 @@ void TermImpl::blink()
             m_screen.cursortype() == screen::cursor_type::CURSOR_BLINK_UNDER ||
             m_screen.cursortype() == screen::cursor_type::CURSOR_BLINK_BAR;
 
-    // see if we have anything blinking and mark blinking lines dirty
-    for (int i = 0; i < m_screen.rows(); i++) {
-        for (const auto& g : m_screen.line(i)) {
-            if (g.attr.blink) {
-                need_blink = true;
+    // the screen counts blinking glyphs as they're written, so
+    // only rows that actually hold some need to be marked dirty
+    if (m_screen.blinkcount() > 0) {
+        need_blink = true;
+        for (int i = 0; i < m_screen.rows(); i++) {
+            if (m_screen.blinkcount(i) > 0)
                 m_screen.setdirty(i, i);
-                break;
-            }
         }
     }
 
@@ -437,26 +469,37 @@ void TermImpl::blink()
     } else {
         // reset and stop blinking
         m_mode[MODE_BLINK] = false;
+        m_blinking = false;
         rwte->stop_blink();
     }
 
     rwte->refresh();
 }
 
+void TermImpl::endsync()
+{
+    if (m_mode[MODE_SYNC]) {
+        m_mode.reset(MODE_SYNC);
+        rwte->end_sync();
+    }
+}
+
 void TermImpl::onresize(const event::Resize& evt)
 {
     resizeCore(evt.cols, evt.rows);
 }
 
-void TermImpl::resizeCore(int cols, int rows)
+void TermImpl::onhistorypush(const event::HistoryPush& evt)
 {
-    LOGGER()->info("resize to {}x{}", cols, rows);
+    m_search.pushed();
+}
 
-    int minrow = std::min(rows, m_screen.rows());
-    int mincol = std::min(cols, m_screen.cols());
+void TermImpl::resizeCore(int cols, int rows)
+{
+    asynclog::info(LOGGER(), "resize to {}x{}", cols, rows);
 
     if (cols < 1 || rows < 1) {
-        LOGGER()->error("attempted resize to {}x{}", cols, rows);
+        asynclog::error(LOGGER(), "attempted resize to {}x{}", cols, rows);
         return;
     }
 
@@ -479,28 +522,21 @@ void TermImpl::resizeCore(int cols, int rows)
             m_tabs[idx] = true;
     }
 
-    // update terminal size
-    m_screen.resize(cols, rows);
+    // update terminal size, reflowing the main screen. new cells
+    // are cleared to the cursor's colors, as clear would
+    const auto& attr = m_screen.cursor().attr;
+    m_screen.resize(cols, rows,
+            {screen::empty_char, {}, attr.fg, attr.bg});
 
     // reset scrolling region
     m_screen.setscroll(0, rows - 1);
     // make use of the LIMIT in moveto
     m_screen.moveto(m_screen.cursor());
 
-    // store cursor
-    // todo: move to screen too, when mode moves. move cursor(int) too
-    screen::Cursor c = m_screen.cursor();
-    // clear both screens (dirties all lines)
-    for (int i = 0; i < 2; i++) {
-        if (mincol < cols && 0 < minrow)
-            m_screen.clear({0, mincol}, {minrow - 1, cols - 1});
-        if (0 < cols && minrow < rows)
-            m_screen.clear({minrow, 0}, {rows - 1, cols - 1});
-        swapscreen();
-        cursor(CURSOR_LOAD);
-    }
-    // reset cursor
-    m_screen.setCursor(c);
+    // history lines were renumbered; find matches again
+    if (m_search.active())
+        m_search.start(m_search.pattern());
+    m_searchcur.reset();
 }
 
 void TermImpl::start_blink()
@@ -508,6 +544,7 @@ void TermImpl::start_blink()
     // reset mode every time this is called, so that the
     // cursor shows while the screen is being updated
     m_mode[MODE_BLINK] = false;
+    m_blinking = true;
     rwte->start_blink();
 }
 
@@ -565,7 +602,7 @@ void TermImpl::putc(char32_t u)
         if (auto tty = m_tty.lock())
             tty->print({c.data(), len});
         else
-            LOGGER()->debug("print without tty");
+            asynclog::debug(LOGGER(), "print without tty");
     }
 
     // STR sequence must be checked before anything else
@@ -594,7 +631,7 @@ void TermImpl::putc(char32_t u)
                 m_mode.set(MODE_SIXEL);
 
             if (m_stresc.len + len >= m_stresc.buf.size() - 1) {
-                LOGGER()->warn("ugh, so, this happened...");
+                asynclog::warn(LOGGER(), "ugh, so, this happened...");
                 // Here is a bug in terminals. If the user never sends
                 // some code to stop the str or esc command, then we
                 // will stop responding. But this is better than
@@ -619,6 +656,7 @@ void TermImpl::putc(char32_t u)
     // because they can be embedded inside a control sequence, and
     // they must not cause conflicts with sequences.
     if (control) {
+        perf::seq(perf::Seq::Control);
         controlcode(u);
 
         // control codes are not shown ever
@@ -648,6 +686,7 @@ void TermImpl::putc(char32_t u)
             // sequence already finished
         }
 
+        perf::seq(perf::Seq::Esc);
         m_esc.reset();
 
         // don't print sequence chars
@@ -660,32 +699,34 @@ void TermImpl::putc(char32_t u)
             sel.ob.row <= cursor.row && cursor.row <= sel.oe.row)
         m_screen.selclear();
 
-    // todo: this seems unsafe / violates principle of least surprise
-    screen::Glyph* gp = &m_screen.glyph(cursor);
+    // note: glyphs are written through the screen rather than held
+    // by pointer, as rows may be cloned (copy-on-write) by any write
     if (m_mode[MODE_WRAP] && (cursor.state & screen::CURSOR_WRAPNEXT)) {
-        gp->attr.wrap = 1;
+        m_screen.glyph(cursor).attr.wrap = 1;
         m_screen.newline(true);
-        gp = &m_screen.glyph(cursor);
     }
 
-    // todo: it's not cool to dig into / make assumptions about screen here
-    if (m_mode[MODE_INSERT] && cursor.col + width < m_screen.cols()) {
-        std::copy_n(gp, m_screen.cols() - cursor.col - width, gp + width);
-    }
+    if (m_mode[MODE_INSERT] && cursor.col + width < m_screen.cols())
+        m_screen.insertblank(width);
 
     if (cursor.col + width > m_screen.cols()) {
+        // a wide glyph that doesn't fit still wraps the line
+        if (m_mode[MODE_WRAP])
+            m_screen.glyph({cursor.row, m_screen.cols() - 1}).attr.wrap = 1;
         m_screen.newline(true);
-        gp = &m_screen.glyph(cursor);
     }
 
-    setchar(u, cursor.attr, cursor);
-
-    if (width == 2) {
-        gp->attr.wide = 1;
-        if (cursor.col + 1 < m_screen.cols()) {
-            gp[1].u = '\0';
-            gp[1].attr = {.wdummy = 1};
-        }
+    screen::Glyph attr = cursor.attr;
+    if (width == 2)
+        attr.attr.wide = 1;
+    setchar(u, attr, cursor);
+
+    if (width == 2 && cursor.col + 1 < m_screen.cols()) {
+        const Cell next{cursor.row, cursor.col + 1};
+        screen::Glyph dummy = std::as_const(m_screen).glyph(next);
+        dummy.u = '\0';
+        dummy.attr = {.wdummy = 1};
+        m_screen.setGlyph(next, dummy);
     }
 
     if (cursor.col + width < m_screen.cols())
@@ -741,7 +782,7 @@ void TermImpl::mousereport(const Cell& cell, mouse_event_enum evt, int button,
 
     if (evt == MOUSE_PRESS || evt == MOUSE_RELEASE) {
         if (button < 1 || 5 < button) {
-            LOGGER()->error("button event {} for unexpected button {}", evt, button);
+            asynclog::error(LOGGER(), "button event {} for unexpected button {}", evt, button);
             return;
         }
     }
@@ -767,10 +808,10 @@ void TermImpl::mousereport(const Cell& cell, mouse_event_enum evt, int button,
         }
 
         if (evt == MOUSE_MOTION) {
-            LOGGER()->trace("mousereport MOTION {}, {}, oldbutton={}, mode={}",
+            asynclog::trace(LOGGER(), "mousereport MOTION {}, {}, oldbutton={}, mode={}",
                     cell.col, cell.row, oldbutton, mode);
         } else {
-            LOGGER()->trace("mousereport {} {}, {}, {}, oldbutton={}, mode={}",
+            asynclog::trace(LOGGER(), "mousereport {} {}, {}, {}, oldbutton={}, mode={}",
                     evt == MOUSE_PRESS ? "PRESS" : "RELEASE",
                     button, cell.col, cell.row, oldbutton, mode);
         }
@@ -839,7 +880,7 @@ void TermImpl::mousereport(const Cell& cell, mouse_event_enum evt, int button,
                         (evt == MOUSE_RELEASE) ? 'm' : 'M');
                 tty->write(seq);
             } else
-                LOGGER()->debug("tried to send SGR mouse without tty");
+                asynclog::debug(LOGGER(), "tried to send SGR mouse without tty");
         } else if (cell.col < 223 && cell.row < 223) {
             if (auto tty = m_tty.lock()) {
                 std::string seq = fmt::format("\033[M{:c}{:c}{:c}",
@@ -847,7 +888,7 @@ void TermImpl::mousereport(const Cell& cell, mouse_event_enum evt, int button,
                         (char) (32 + cell.row + 1));
                 tty->write(seq);
             } else
-                LOGGER()->debug("tried to send extended mouse without tty");
+                asynclog::debug(LOGGER(), "tried to send extended mouse without tty");
         } else {
             // row or col is out of range...can't report unless
             // we're in MOUSESGR
@@ -898,7 +939,7 @@ void TermImpl::mousereport(const Cell& cell, mouse_event_enum evt, int button,
 
                 if (sel.snap != Selection::Snap::None)
                     sel.setmode(Selection::Mode::Ready);
-                m_screen.setdirty(sel.nb.row, sel.ne.row);
+                m_screen.selupdate();
                 sel.tclick2 = sel.tclick1;
                 sel.tclick1 = now;
             }
@@ -907,7 +948,7 @@ void TermImpl::mousereport(const Cell& cell, mouse_event_enum evt, int button,
                 if (auto window = m_window.lock())
                     window->selpaste();
                 else
-                    LOGGER()->debug("mouse release (2) without window");
+                    asynclog::debug(LOGGER(), "mouse release (2) without window");
             } else if (button == 1) {
                 auto& sel = m_screen.sel();
                 if (sel.mode() == Selection::Mode::Ready) {
@@ -918,12 +959,12 @@ void TermImpl::mousereport(const Cell& cell, mouse_event_enum evt, int button,
                     if (auto window = m_window.lock())
                         window->setsel();
                     else
-                        LOGGER()->debug("mouse release (1) without window");
+                        asynclog::debug(LOGGER(), "mouse release (1) without window");
                 } else
                     m_screen.selclear();
 
                 sel.setmode(Selection::Mode::Idle);
-                m_screen.setdirty(sel.nb.row, sel.ne.row);
+                m_screen.selupdate();
             }
         } else if (evt == MOUSE_MOTION) {
             auto& sel = m_screen.sel();
@@ -931,14 +972,10 @@ void TermImpl::mousereport(const Cell& cell, mouse_event_enum evt, int button,
                 return;
 
             sel.setmode(Selection::Mode::Ready);
-            Cell oldoe = sel.oe;
-            int oldsbrow = sel.nb.row;
-            int oldserow = sel.ne.row;
             getbuttoninfo(cell, mod);
 
-            if (oldoe != sel.oe)
-                m_screen.setdirty(std::min(sel.nb.row, oldsbrow),
-                        std::max(sel.ne.row, oldserow));
+            // only rows whose selected columns changed are redrawn
+            m_screen.selupdate();
         }
     }
 }
@@ -950,6 +987,76 @@ void TermImpl::swapscreen()
     m_mode.flip(MODE_ALTSCREEN);
 }
 
+void TermImpl::search(std::string_view pattern)
+{
+    if (pattern != m_search.pattern())
+        m_search.start(std::string{pattern});
+    m_searchcur.reset();
+    setdirty();
+}
+
+bool TermImpl::searchstep(int dir, search::Match& match)
+{
+    if (!m_search.active())
+        return false;
+
+    const auto base = searchbase();
+    const auto rows = static_cast<std::size_t>(m_screen.rows());
+
+    // start from the current match, or from the bottom going up (or
+    // the top going down)
+    std::size_t line = base + rows;
+    int col = 0;
+    if (m_searchcur) {
+        line = m_searchcur->line;
+        col = m_searchcur->col;
+    } else if (dir > 0) {
+        line = 0;
+        col = -1;
+    }
+
+    // the visible screen isn't indexed, so look there directly
+    std::optional<search::Match> found;
+    std::vector<search::Match> matches;
+    for (int r = 0; r < m_screen.rows(); r++)
+        search::findrow(m_screen.line(r), m_search.pattern(), base + r,
+                matches);
+    for (const auto& m : matches) {
+        const bool after = std::tie(m.line, m.col) > std::tie(line, col);
+        const bool before = std::tie(m.line, m.col) < std::tie(line, col);
+        if (dir < 0 && before)
+            found = m; // keep the last one before
+        else if (dir > 0 && after) {
+            found = m;
+            break;
+        }
+    }
+
+    // history lines all come before the screen's
+    if (dir < 0 && !found)
+        found = m_search.find(line, col, dir);
+    else if (dir > 0 && line < base) {
+        if (auto m = m_search.find(line, col, dir))
+            found = m;
+    }
+
+    if (!found)
+        return false;
+
+    m_searchcur = found;
+    match = *found;
+    setdirty();
+    return true;
+}
+
+bool TermImpl::searchcurrent(search::Match& match) const
+{
+    if (!m_searchcur)
+        return false;
+    match = *m_searchcur;
+    return true;
+}
+
 void TermImpl::setfocused(bool focused)
 {
     m_focused = focused;
@@ -961,7 +1068,7 @@ void TermImpl::setfocused(bool focused)
             else
                 tty->write({"\033[O", 3});
         } else
-            LOGGER()->debug("tried to send focus without tty");
+            asynclog::debug(LOGGER(), "tried to send focus without tty");
     }
 
     rwte->refresh();
@@ -974,7 +1081,7 @@ void TermImpl::clipcopy()
     if (auto window = m_window.lock())
         window->setclip();
     else
-        LOGGER()->debug("clip copy without window");
+        asynclog::debug(LOGGER(), "clip copy without window");
 }
 
 void TermImpl::send(std::string_view data)
@@ -982,7 +1089,13 @@ void TermImpl::send(std::string_view data)
     if (auto tty = m_tty.lock())
         tty->write(data);
     else
-        LOGGER()->debug("tried to send without tty");
+        asynclog::debug(LOGGER(), "tried to send without tty");
+}
+
+void TermImpl::pastecancel()
+{
+    if (auto tty = m_tty.lock())
+        tty->pastecancel();
 }
 
 void TermImpl::setchar(char32_t u, const screen::Glyph& attr, const Cell& cell)
@@ -1026,7 +1139,8 @@ void TermImpl::setchar(char32_t u, const screen::Glyph& attr, const Cell& cell)
     thisGlyph.u = u;
     m_screen.setGlyph(cell, thisGlyph);
 
-    if (attr.attr.blink)
+    // arm the timer once; blink() stops it when nothing blinks
+    if (attr.attr.blink && !m_blinking)
         start_blink();
 }
 
@@ -1054,7 +1168,7 @@ void TermImpl::deftran(char ascii)
         }
     }
     if (it == cs.cend())
-        LOGGER()->error("esc unhandled charset: ESC ( {}", ascii);
+        asynclog::error(LOGGER(), "esc unhandled charset: ESC ( {}", ascii);
 }
 
 void TermImpl::dectest(char c)
@@ -1101,7 +1215,7 @@ void TermImpl::controlcode(unsigned char ascii)
                     if (auto window = m_window.lock())
                         window->seturgent(true);
                     else
-                        LOGGER()->debug("set urgent without window");
+                        asynclog::debug(LOGGER(), "set urgent without window");
                 }
 
                 // default bell_volume to 0 if invalid
@@ -1112,7 +1226,7 @@ void TermImpl::controlcode(unsigned char ascii)
                     if (auto window = m_window.lock())
                         window->bell(bell_volume);
                     else
-                        LOGGER()->debug("bell without window");
+                        asynclog::debug(LOGGER(), "bell without window");
                 }
             }
             break;
@@ -1177,7 +1291,7 @@ void TermImpl::controlcode(unsigned char ascii)
                 auto term_id = lua::config::get_string("term_id");
                 tty->write(term_id);
             } else
-                LOGGER()->debug("tried to send termid (9a) without tty");
+                asynclog::debug(LOGGER(), "tried to send termid (9a) without tty");
         } break;
         case 0x9b: // TODO: CSI
         case 0x9c: // TODO: ST
@@ -1252,7 +1366,7 @@ bool TermImpl::eschandle(unsigned char ascii)
                 auto term_id = lua::config::get_string("term_id");
                 tty->write(term_id);
             } else
-                LOGGER()->debug("tried to send termid (Z) without tty");
+                asynclog::debug(LOGGER(), "tried to send termid (Z) without tty");
         } break;
         case 'c': // RIS -- Reset to inital state
             reset();
@@ -1277,7 +1391,7 @@ bool TermImpl::eschandle(unsigned char ascii)
                 strhandle();
             break;
         default:
-            LOGGER()->error("unknown sequence ESC 0x{:02X} '{}'",
+            asynclog::error(LOGGER(), "unknown sequence ESC 0x{:02X} '{}'",
                     (unsigned char) ascii, isprint(ascii) ? ascii : '.');
             break;
     }
@@ -1289,7 +1403,7 @@ void TermImpl::resettitle()
     if (auto window = m_window.lock())
         window->settitle(options.title);
     else
-        LOGGER()->debug("reset title without window");
+        asynclog::debug(LOGGER(), "reset title without window");
 }
 
 void TermImpl::puttab(int n)
@@ -1336,6 +1450,9 @@ void TermImpl::strparse()
 
 void TermImpl::strhandle()
 {
+    TRACE_SCOPE("strhandle");
+    perf::seq(perf::Seq::Str);
+
     // todo: color
     // char *p = nullptr;
     // int j;
@@ -1359,7 +1476,12 @@ void TermImpl::strhandle()
     }
     */
 
-    LOGGER()->trace("strhandle {}", strdump());
+    // the type isn't in buf, so this one needs a copy
+    if (asynclog::enabled(LOGGER(), rw::logging::log_level::trace)) {
+        std::string bytes{m_stresc.type};
+        bytes.append(strbytes());
+        asynclog::sequence(LOGGER(), "strhandle ESC", bytes);
+    }
 
     switch (m_stresc.type) {
         case ']': // OSC -- Operating System Command
@@ -1371,7 +1493,7 @@ void TermImpl::strhandle()
                         if (auto window = m_window.lock())
                             window->settitle(m_stresc.args[1]);
                         else
-                            LOGGER()->debug("set title (OSC 0,1,2) without window");
+                            asynclog::debug(LOGGER(), "set title (OSC 0,1,2) without window");
                     }
                     return;
                 case 11:
@@ -1388,7 +1510,8 @@ void TermImpl::strhandle()
                     return;
                 case 52:
                     // todo: remove dump
-                    LOGGER()->debug("OSC 52: {}", strdump());
+                    asynclog::debug(LOGGER(), "OSC 52: {}",
+                            asynclog::lazy([this] { return strdump(); }));
                     if (narg > 2) {
                         // todo: color
                         //char *dec = base64dec(m_stresc.args[2]);
@@ -1408,7 +1531,8 @@ void TermImpl::strhandle()
                     [[fallthrough]];
                 case 104: // color reset, here p = NULL
                     // todo: remove dump
-                    LOGGER()->debug("OSC 4/104: {}", strdump());
+                    asynclog::debug(LOGGER(), "OSC 4/104: {}",
+                            asynclog::lazy([this] { return strdump(); }));
                     /*
             use std::from_chars
             j = (narg > 1) ? atoi(m_stresc.args[1]) : -1;
@@ -1432,7 +1556,7 @@ void TermImpl::strhandle()
             if (auto window = m_window.lock())
                 window->settitle(m_stresc.args[0]);
             else
-                LOGGER()->debug("set title (k) without window");
+                asynclog::debug(LOGGER(), "set title (k) without window");
             return;
         case 'P': // DCS -- Device Control String
             m_esc.set(ESC_DCS);
@@ -1441,35 +1565,21 @@ void TermImpl::strhandle()
             return;
     }
 
-    LOGGER()->error("unknown stresc: {}", strdump());
+    asynclog::error(LOGGER(), "unknown stresc: {}",
+            asynclog::lazy([this] { return strdump(); }));
 }
 
-std::string TermImpl::strdump()
+std::string_view TermImpl::strbytes() const
 {
-    fmt::memory_buffer msg;
-
-    fmt::format_to(msg, "ESC");
-    fmt::format_to(msg, "{}", m_stresc.type);
-
-    for (std::size_t i = 0; i < m_stresc.len; i++) {
-        // todo: is this & necessary? does it just make it unsigned?
-        unsigned int c = m_stresc.buf[i] & 0xff;
-        if (c == '\0')
-            return fmt::to_string(msg); // early exit
-        else if (isprint(c))
-            fmt::format_to(msg, "{}", static_cast<char>(c));
-        else if (c == '\n')
-            fmt::format_to(msg, "(\\n)");
-        else if (c == '\r')
-            fmt::format_to(msg, "(\\r)");
-        else if (c == 0x1b)
-            fmt::format_to(msg, "(\\e)");
-        else
-            fmt::format_to(msg, "(0x{:02X})", c);
-    }
+    // args have been split on nul by now, so stop at the first
+    std::string_view bytes{m_stresc.buf.data(), m_stresc.len};
+    return bytes.substr(0, bytes.find('\0'));
+}
 
-    fmt::format_to(msg, "ESC\\\n");
-    return fmt::to_string(msg);
+std::string TermImpl::strdump() const
+{
+    return fmt::format("ESC{}{}ESC\\\n", m_stresc.type,
+            asynclog::escape(strbytes()));
 }
 
 void TermImpl::strsequence(unsigned char c)
@@ -1530,7 +1640,11 @@ void TermImpl::csiparse()
 
 void TermImpl::csihandle()
 {
-    LOGGER()->trace("csiesc {}", csidump());
+    TRACE_SCOPE("csihandle");
+    perf::seq(perf::Seq::Csi);
+
+    asynclog::sequence(LOGGER(), "csiesc ESC[",
+            {m_csiesc.buf.data(), m_csiesc.len});
 
     auto& cursor = m_screen.cursor();
     switch (m_csiesc.mode[0]) {
@@ -1576,7 +1690,7 @@ void TermImpl::csihandle()
                     auto term_id = lua::config::get_string("term_id");
                     tty->write(term_id);
                 } else
-                    LOGGER()->debug("tried to send termid (c) without tty");
+                    asynclog::debug(LOGGER(), "tried to send termid (c) without tty");
             }
             break;
         case 'C': // CUF -- Cursor <n> Forward
@@ -1642,6 +1756,9 @@ void TermImpl::csihandle()
                 case 2: // all
                     m_screen.clear();
                     break;
+                case 3: // saved lines
+                    m_screen.clearhistory();
+                    break;
                 default:
                     goto unknown;
             }
@@ -1708,7 +1825,7 @@ void TermImpl::csihandle()
                             cursor.row + 1, cursor.col + 1);
                     tty->write(seq);
                 } else
-                    LOGGER()->debug("report cursor status without tty");
+                    asynclog::debug(LOGGER(), "report cursor status without tty");
             }
             break;
         case 'r': // DECSTBM -- Set Scrolling Region
@@ -1754,7 +1871,7 @@ void TermImpl::csihandle()
                         default:
                             m_screen.setCursortype(screen::cursor_type::CURSOR_BLINK_BLOCK);
                             start_blink();
-                            LOGGER()->error("unknown cursor {}", m_csiesc.arg[0]);
+                            asynclog::error(LOGGER(), "unknown cursor {}", m_csiesc.arg[0]);
                             break;
                     }
                     break;
@@ -1762,37 +1879,35 @@ void TermImpl::csihandle()
                     goto unknown;
             }
             break;
+        case '$':
+            switch (m_csiesc.mode[1]) {
+                case 'p': // DECRQM -- Request Mode
+                    if (auto tty = m_tty.lock()) {
+                        auto seq = fmt::format(
+                                "\033[{}{};{}$y",
+                                m_csiesc.priv ? "?" : "",
+                                m_csiesc.arg[0],
+                                modestate(m_csiesc.priv, m_csiesc.arg[0]));
+                        tty->write(seq);
+                    } else
+                        asynclog::debug(LOGGER(), "report mode without tty");
+                    break;
+                default:
+                    goto unknown;
+            }
+            break;
         default:
         unknown:
-            LOGGER()->error("unknown csiesc {}: {}",
-                    m_csiesc.mode[0], csidump());
+            asynclog::error(LOGGER(), "unknown csiesc {}: {}",
+                    m_csiesc.mode[0],
+                    asynclog::lazy([this] { return csidump(); }));
             break;
     }
 }
 
-std::string TermImpl::csidump()
+std::string TermImpl::csidump() const
 {
-    fmt::memory_buffer msg;
-
-    fmt::format_to(msg, "ESC[");
-
-    for (std::size_t i = 0; i < m_csiesc.len; i++) {
-        // todo: is this & necessary? does it just make it unsigned?
-        unsigned int c = m_csiesc.buf[i] & 0xff;
-        if (isprint(c))
-            // this is crazy...need to cast it back?
-            fmt::format_to(msg, "{}", static_cast<char>(c));
-        else if (c == '\n')
-            fmt::format_to(msg, "(\\n)");
-        else if (c == '\r')
-            fmt::format_to(msg, "(\\r)");
-        else if (c == 0x1b)
-            fmt::format_to(msg, "(\\e)");
-        else
-            fmt::format_to(msg, "(0x{:02X})", c);
-    }
-
-    return fmt::to_string(msg);
+    return "ESC[" + asynclog::escape({m_csiesc.buf.data(), m_csiesc.len});
 }
 
 // todo: std::span when c++ 20
@@ -1917,9 +2032,10 @@ void TermImpl::setattr(const int* attr, std::size_t len)
                     cursor.attr.bg = attr[i] - 100 + 8;
                     m_screen.setCursor(cursor);
                 } else {
-                    LOGGER()->error(
+                    asynclog::error(LOGGER(),
                             "erresc(default): gfx attr {} unknown, {}",
-                            attr[i], csidump());
+                            attr[i],
+                            asynclog::lazy([this] { return csidump(); }));
                 }
                 break;
         }
@@ -2022,15 +2138,22 @@ void TermImpl::settmode(bool priv, bool set, const int* args, int narg)
                 case 2004: // 2004: bracketed paste mode
                     m_mode.set(MODE_BRCKTPASTE, set);
                     break;
+                case 2026: // 2026: synchronized update
+                    if (set && !m_mode[MODE_SYNC]) {
+                        m_mode.set(MODE_SYNC);
+                        rwte->start_sync();
+                    } else if (!set)
+                        endsync();
+                    break;
                 // unimplemented mouse modes:
                 case 1001: // VT200 mouse highlight mode; can hang the terminal
                 case 1005: // UTF-8 mouse mode; will confuse non-UTF-8 applications
                 case 1015: // urxvt mangled mouse mode; incompatible
                            // and can be mistaken for other control codes
-                    LOGGER()->warn("unsupported mouse mode requested {}", *args);
+                    asynclog::warn(LOGGER(), "unsupported mouse mode requested {}", *args);
                     break;
                 default:
-                    LOGGER()->error(
+                    asynclog::error(LOGGER(),
                             "erresc: unknown private set/reset mode {}",
                             *args);
                     break;
@@ -2052,7 +2175,7 @@ void TermImpl::settmode(bool priv, bool set, const int* args, int narg)
                     m_mode.set(MODE_CRLF, set);
                     break;
                 default:
-                    LOGGER()->error(
+                    asynclog::error(LOGGER(),
                             "erresc: unknown set/reset mode {}",
                             *args);
                     break;
@@ -2061,6 +2184,82 @@ void TermImpl::settmode(bool priv, bool set, const int* args, int narg)
     }
 }
 
+// mode state values reported by DECRPM
+enum mode_state
+{
+    MODESTATE_UNKNOWN = 0,
+    MODESTATE_SET = 1,
+    MODESTATE_RESET = 2,
+    MODESTATE_PERM_RESET = 4
+};
+
+int TermImpl::modestate(bool priv, int mode) const
+{
+    auto state = [](bool set) {
+        return set ? MODESTATE_SET : MODESTATE_RESET;
+    };
+
+    if (priv) {
+        switch (mode) {
+            case 1:
+                return state(m_mode[MODE_APPCURSOR]);
+            case 5:
+                return state(m_mode[MODE_REVERSE]);
+            case 6:
+                return state(m_screen.cursor().state & screen::CURSOR_ORIGIN);
+            case 7:
+                return state(m_mode[MODE_WRAP]);
+            case 25:
+                return state(!m_mode[MODE_HIDE]);
+            case 9:
+                return state(m_mode[MODE_MOUSEX10]);
+            case 1000:
+                return state(m_mode[MODE_MOUSEBTN]);
+            case 1002:
+                return state(m_mode[MODE_MOUSEMOTION]);
+            case 1003:
+                return state(m_mode[MODE_MOUSEMANY]);
+            case 1004:
+                return state(m_mode[MODE_FOCUS]);
+            case 1006:
+                return state(m_mode[MODE_MOUSESGR]);
+            case 1034:
+                return state(m_mode[MODE_8BIT]);
+            case 47:
+            case 1047:
+            case 1049:
+                return state(m_mode[MODE_ALTSCREEN]);
+            case 2004:
+                return state(m_mode[MODE_BRCKTPASTE]);
+            case 2026:
+                return state(m_mode[MODE_SYNC]);
+            case 2:  // DECANM
+            case 3:  // DECCOLM
+            case 4:  // DECSCLM
+            case 8:  // DECARM
+            case 18: // DECPFF
+            case 19: // DECPEX
+            case 42: // DECNRCM
+                return MODESTATE_PERM_RESET;
+            default:
+                return MODESTATE_UNKNOWN;
+        }
+    } else {
+        switch (mode) {
+            case 2:
+                return state(m_mode[MODE_KBDLOCK]);
+            case 4:
+                return state(m_mode[MODE_INSERT]);
+            case 12:
+                return state(!m_mode[MODE_ECHO]);
+            case 20:
+                return state(m_mode[MODE_CRLF]);
+            default:
+                return MODESTATE_UNKNOWN;
+        }
+    }
+}
+
 void TermImpl::getbuttoninfo(const Cell& cell, const keymod_state& mod)
 {
     auto& sel = m_screen.sel();
@@ -2093,7 +2292,7 @@ void Term::setTty(std::shared_ptr<Tty> tty)
 
 const screen::Glyph& Term::glyph(const Cell& cell) const
 {
-    return impl->glyph(cell);
+    return std::as_const(*impl).glyph(cell);
 }
 
 screen::Glyph& Term::glyph(const Cell& cell)
@@ -2121,6 +2320,11 @@ void Term::blink()
     impl->blink();
 }
 
+void Term::endsync()
+{
+    impl->endsync();
+}
+
 const Selection& Term::sel() const
 {
     return impl->sel();
@@ -2136,6 +2340,11 @@ screen::cursor_type Term::cursortype() const
     return impl->cursortype();
 }
 
+screen::ScreenView Term::snapshot() const
+{
+    return impl->snapshot();
+}
+
 bool Term::isdirty(int row) const
 {
     return impl->isdirty(row);
@@ -2151,6 +2360,36 @@ void Term::cleardirty(int row)
     impl->cleardirty(row);
 }
 
+std::size_t Term::memsize() const
+{
+    return impl->memsize();
+}
+
+void Term::search(std::string_view pattern)
+{
+    impl->search(pattern);
+}
+
+bool Term::searchstep(int dir, search::Match& match)
+{
+    return impl->searchstep(dir, match);
+}
+
+bool Term::searchcurrent(search::Match& match) const
+{
+    return impl->searchcurrent(match);
+}
+
+const std::string& Term::searchpattern() const
+{
+    return impl->searchpattern();
+}
+
+std::size_t Term::searchbase() const
+{
+    return impl->searchbase();
+}
+
 void Term::putc(char32_t u)
 {
     impl->putc(u);
@@ -2217,4 +2456,9 @@ void Term::send(std::string_view data)
     impl->send(data);
 }
 
+void Term::pastecancel()
+{
+    impl->pastecancel();
+}
+
 } // namespace term
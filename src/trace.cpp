@@ -0,0 +1,140 @@
+#include "fmt/format.h"
+#include "rw/logging.h"
+#include "rwte/trace.h"
+
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unistd.h>
+#include <vector>
+
+#define LOGGER() (rw::logging::get("trace"))
+
+namespace trace {
+
+namespace detail {
+
+std::atomic<bool> active{false};
+
+namespace {
+
+struct Event
+{
+    const char* name;
+    uint64_t start, end;
+};
+
+// single producer ring; only its own thread writes, and dump reads
+// up to the published head. the oldest events are overwritten once
+// it wraps.
+struct Ring
+{
+    static constexpr std::size_t capacity = 1 << 16;
+
+    std::array<Event, capacity> events;
+    std::atomic<uint64_t> head{0};
+    int tid;
+};
+
+// rings outlive their threads, so a dump can still see them
+std::mutex rings_mutex;
+std::vector<std::unique_ptr<Ring>> rings;
+
+Ring* thread_ring()
+{
+    thread_local Ring* ring = nullptr;
+    if (!ring) {
+        std::lock_guard lock{rings_mutex};
+        rings.push_back(std::make_unique<Ring>());
+        ring = rings.back().get();
+        ring->tid = rings.size();
+    }
+    return ring;
+}
+
+} // namespace
+
+void record(const char* name, uint64_t start, uint64_t end)
+{
+    auto ring = thread_ring();
+
+    auto head = ring->head.load(std::memory_order_relaxed);
+    ring->events[head % Ring::capacity] = {name, start, end};
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+} // namespace detail
+
+void start()
+{
+    LOGGER()->info("tracing started");
+    detail::active.store(true, std::memory_order_relaxed);
+}
+
+void stop()
+{
+    detail::active.store(false, std::memory_order_relaxed);
+    LOGGER()->info("tracing stopped");
+}
+
+bool dump(const std::string& path)
+{
+    using namespace detail;
+
+    std::unique_ptr<FILE, decltype(&fclose)> f{
+            fopen(path.c_str(), "w"), &fclose};
+    if (!f) {
+        LOGGER()->error("could not open {} for trace", path);
+        return false;
+    }
+
+    const int pid = getpid();
+    std::size_t count = 0;
+    bool first = true;
+
+    auto sep = [&] {
+        const char* s = first ? "\n" : ",\n";
+        first = false;
+        return s;
+    };
+
+    fmt::print(f.get(), "{{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    std::lock_guard lock{rings_mutex};
+    for (const auto& ring : rings) {
+        fmt::print(f.get(), "{}{{\"name\":\"thread_name\",\"ph\":\"M\","
+                            "\"pid\":{},\"tid\":{},"
+                            "\"args\":{{\"name\":\"thread {}\"}}}}",
+                sep(), pid, ring->tid, ring->tid);
+
+        // events from an active writer may be torn; those are
+        // only ever the oldest, about to be overwritten
+        auto head = ring->head.load(std::memory_order_acquire);
+        auto begin = head > Ring::capacity ? head - Ring::capacity : 0;
+        for (auto i = begin; i < head; i++) {
+            const auto& e = ring->events[i % Ring::capacity];
+            fmt::print(f.get(), "{}{{\"name\":\"{}\",\"ph\":\"X\","
+                                "\"pid\":{},\"tid\":{},"
+                                "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                    sep(), e.name, pid, ring->tid,
+                    e.start / 1e3, (e.end - e.start) / 1e3);
+            count++;
+        }
+    }
+
+    fmt::print(f.get(), "\n]}}\n");
+
+    LOGGER()->info("wrote {} trace events to {}", count, path);
+    return true;
+}
+
+std::string default_path()
+{
+    const char* dir = getenv("TMPDIR");
+    return fmt::format("{}/rwte-{}.trace.json",
+            dir && *dir ? dir : "/tmp", getpid());
+}
+
+} // namespace trace
@@ -1,17 +1,24 @@
 #include "fmt/format.h"
+#include "lua/config.h"
 #include "lua/state.h"
 #include "rw/logging.h"
 #include "rw/utf8.h"
 #include "rwte/asyncio.h"
+#include "rwte/asynclog.h"
 #include "rwte/config.h"
+#include "rwte/perf.h"
+#include "rwte/printlog.h"
+#include "rwte/recording.h"
 #include "rwte/rwte.h"
 #include "rwte/term.h"
+#include "rwte/trace.h"
 #include "rwte/tty.h"
 #include "rwte/window.h"
 
 #include <algorithm>
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
 #include <fcntl.h>
 #include <pty.h>
 #include <pwd.h>
@@ -22,6 +29,14 @@
 // most we write in a chunk
 constexpr std::size_t max_write = 255;
 
+// most paste data buffered, and how low it goes before asking for more
+constexpr std::size_t paste_max = 256 * 1024;
+constexpr std::size_t paste_low = paste_max / 2;
+
+// bracketed paste markers
+constexpr std::string_view paste_open = "\033[200~";
+constexpr std::string_view paste_close = "\033[201~";
+
 #if !defined(BUILD_WAYLAND_ONLY)
 static void setenv_windowid(Window* window)
 {
@@ -160,15 +175,28 @@ public:
 
     void open(Window* window);
 
+    void write(std::string_view data);
+
+    void pastebegin();
+    void paste(std::string_view data);
+    void pasteend();
+    void pastecancel();
+    bool pasting() const { return m_pasting; }
+    std::size_t pasteroom() const;
+
     void print(std::string_view data);
 
     void hup();
 
 private:
     void onresize(const event::Resize& evt);
+    void startprint();
 
     friend class AsyncIO<TtyImpl, max_write>;
+    void log_read(const char* data, size_t len);
     void log_write(bool initial, const char* data, size_t len);
+    void log_buffered(size_t len);
+    void log_low(size_t len);
     // todo: string_view
     std::size_t onread(const char* ptr, std::size_t len);
 
@@ -176,7 +204,21 @@ private:
     std::shared_ptr<term::Term> m_term;
     int m_resizeReg;
     pid_t m_pid;
-    int m_iofd;
+    int m_iofd; // until startprint hands it to m_printer
+    std::unique_ptr<printlog::Writer> m_printer;
+    std::unique_ptr<recording::Writer> m_recorder;
+
+    bool m_pasting = false;
+    bool m_bracketed = false;
+    bool m_pastewait = false; // waiting to drain to paste_low
+    uint64_t m_pastefrom = 0; // low queue positions of the paste data
+    uint64_t m_pasteend = 0;
+    std::string m_pastebuf;
+
+    // writes held while a bracketed paste is open, until its close
+    // marker is written, so they aren't taken as pasted
+    bool m_inbrackets = false;
+    std::string m_held;
 };
 
 TtyImpl::TtyImpl(std::shared_ptr<event::Bus> bus,
@@ -190,15 +232,22 @@ TtyImpl::TtyImpl(std::shared_ptr<event::Bus> bus,
     m_iofd(-1)
 {
     if (!options.io.empty()) {
-        LOGGER()->debug("logging to {}", options.io);
+        LOGGER()->debug("{} to {}",
+                options.record ? "recording" : "logging", options.io);
 
-        m_term->setprint();
         // todo: need CLOEXEC?
-        m_iofd = (options.io == "-") ? STDOUT_FILENO : ::open(options.io.c_str(), O_WRONLY | O_CREAT, 0666);
-        if (m_iofd < 0) {
+        int flags = O_WRONLY | O_CREAT | (options.record ? O_TRUNC : 0);
+        int fd = (options.io == "-") ? STDOUT_FILENO : ::open(options.io.c_str(), flags, 0666);
+        if (fd < 0) {
             LOGGER()->error("error opening {}: {}",
                     options.io, strerror(errno));
-            m_iofd = -1;
+        } else if (options.record) {
+            // raw, timestamped pty output rather than printed chars
+            m_recorder = std::make_unique<recording::Writer>(
+                    fd, m_term->cols(), m_term->rows());
+        } else {
+            m_term->setprint();
+            m_iofd = fd;
         }
     }
 }
@@ -224,6 +273,7 @@ void TtyImpl::open(Window* window)
         setFd(fd);
 
         stty();
+        startprint();
         return;
     }
 
@@ -244,6 +294,7 @@ void TtyImpl::open(Window* window)
         case 0: // child
             if (m_iofd != -1)
                 close(m_iofd);
+            m_recorder.reset();
             setsid(); // create a new process group
             dup2(child, STDIN_FILENO);
             dup2(child, STDOUT_FILENO);
@@ -260,34 +311,130 @@ void TtyImpl::open(Window* window)
             m_pid = pid;
 
             setFd(parent);
+            startprint();
             break;
     }
 }
 
-void TtyImpl::print(std::string_view data)
+void TtyImpl::startprint()
 {
-    // todo: refactor
-    auto pdata = data.data();
-    auto len = data.size();
-
-    if (m_iofd != -1 && len > 0) {
-        ssize_t r;
-        while (len > 0) {
-            r = ::write(m_iofd, pdata, len);
-            if (r < 0) {
-                LOGGER()->error("error writing in {}: {}",
-                        options.io, strerror(errno));
-                close(m_iofd);
-                m_iofd = -1;
-                break;
-            }
+    if (m_iofd == -1)
+        return;
+
+    // the writer has a thread, so it's only started after the fork
+    const std::size_t kb = 1024;
+    printlog::Options opts;
+    opts.rotate_bytes = std::max(lua::config::get_int("io_rotate_kb", 0), 0) * kb;
+    opts.keep = std::max(lua::config::get_int("io_rotate_keep", 1), 0);
+    opts.max_pending = std::max(lua::config::get_int("io_buffer_kb", 4096), 0) * kb;
 
-            len -= r;
-            pdata += r;
+    m_printer = std::make_unique<printlog::Writer>(m_iofd,
+            options.io == "-" ? std::string{} : options.io, opts);
+    m_iofd = -1;
+}
+
+void TtyImpl::write(std::string_view data)
+{
+    if (m_inbrackets)
+        m_held.append(data);
+    else
+        AsyncIO<TtyImpl, max_write>::write(data);
+}
+
+void TtyImpl::pastebegin()
+{
+    if (m_pasting)
+        pastecancel();
+
+    // anything held for the last paste goes after its close marker
+    if (m_inbrackets) {
+        writelow(m_held);
+        m_held.clear();
+        m_inbrackets = false;
+    }
+
+    m_pasting = true;
+    m_bracketed = m_term->mode()[term::MODE_BRCKTPASTE];
+    if (m_bracketed) {
+        writelow(paste_open);
+        m_inbrackets = true;
+    }
+    m_pastefrom = lowqueued();
+}
+
+void TtyImpl::paste(std::string_view data)
+{
+    if (!m_pasting)
+        return;
+
+    // copy, fixing line endings (\n -> \r); memchr is vectorized
+    m_pastebuf.clear();
+    while (!data.empty()) {
+        auto nl = static_cast<const char*>(
+                std::memchr(data.data(), '\n', data.size()));
+        if (!nl) {
+            m_pastebuf.append(data);
+            break;
         }
+
+        const std::size_t len = nl - data.data();
+        m_pastebuf.append(data.data(), len);
+        m_pastebuf.push_back('\r');
+        data.remove_prefix(len + 1);
+    }
+
+    writelow(m_pastebuf);
+    if (lowpending() > paste_low)
+        m_pastewait = true;
+}
+
+void TtyImpl::pasteend()
+{
+    if (!m_pasting)
+        return;
+
+    m_pasteend = lowqueued();
+    if (m_bracketed)
+        writelow(paste_close);
+    m_pasting = false;
+    m_pastewait = false;
+}
+
+void TtyImpl::pastecancel()
+{
+    // a paste that's ended may still have data waiting to be written
+    const uint64_t written = lowqueued() - lowpending();
+    if (!m_pasting && written >= m_pasteend)
+        return;
+
+    LOGGER()->debug("paste cancelled, {} bytes dropped",
+            lowqueued() - std::max(written, m_pastefrom));
+    droplow(m_pastefrom);
+    if (m_pasting) {
+        pasteend();
+
+        // whoever is feeding the paste may be waiting for room that
+        // won't come now; wake them to see it's over
+        m_bus->publish(event::PasteReady{});
+    } else {
+        m_pasteend = lowqueued();
+        if (m_bracketed)
+            writelow(paste_close);
     }
 }
 
+std::size_t TtyImpl::pasteroom() const
+{
+    const auto pending = lowpending();
+    return pending < paste_max ? paste_max - pending : 0;
+}
+
+void TtyImpl::print(std::string_view data)
+{
+    if (m_printer)
+        m_printer->print(data);
+}
+
 void TtyImpl::hup()
 {
     // send SIGHUP to shell
@@ -296,7 +443,7 @@ void TtyImpl::hup()
 
 void TtyImpl::onresize(const event::Resize& evt)
 {
-    LOGGER()->info("resize to {}x{}", evt.cols, evt.rows);
+    asynclog::info(LOGGER(), "resize to {}x{}", evt.cols, evt.rows);
 
     struct winsize w
     {
@@ -308,31 +455,53 @@ void TtyImpl::onresize(const event::Resize& evt)
 
     if (ioctl(fd(), TIOCSWINSZ, &w) < 0)
         LOGGER()->error("could not set window size: {}", strerror(errno));
+
+    if (m_recorder)
+        m_recorder->resize(evt.cols, evt.rows);
+}
+
+void TtyImpl::log_read(const char* data, size_t len)
+{
+    perf::pty_read(len);
+
+    if (m_recorder)
+        m_recorder->data({data, len});
 }
 
 void TtyImpl::log_write(bool initial, const char* data, size_t len)
 {
-    if (rw::logging::log_level::trace < LOGGER()->level())
-        return;
+    perf::pty_written(len);
 
-    fmt::memory_buffer msg;
+    asynclog::sequence(LOGGER(), initial ? "wrote" : "wrote buffered",
+            {data, len});
+}
 
-    for (size_t i = 0; i < len; i++) {
-        char ch = data[i];
-        if (ch == '\033')
-            fmt::format_to(msg, "ESC");
-        else if (isprint(ch))
-            fmt::format_to(msg, "{}", ch);
-        else
-            fmt::format_to(msg, "<{:02x}>", (unsigned int) ch);
+void TtyImpl::log_buffered(size_t len)
+{
+    perf::write_buffered(len);
+}
+
+void TtyImpl::log_low(size_t len)
+{
+    // the close marker's out; let held writes go
+    if (m_inbrackets && !m_pasting &&
+            lowqueued() - len >= m_pasteend + paste_close.size()) {
+        m_inbrackets = false;
+        AsyncIO<TtyImpl, max_write>::write(m_held);
+        m_held.clear();
     }
 
-    LOGGER()->trace("wrote '{}' ({}, {})", msg.data(), len, initial);
+    if (m_pastewait && len <= paste_low) {
+        m_pastewait = false;
+        m_bus->publish(event::PasteReady{});
+    }
 }
 
 // todo: string_view
 std::size_t TtyImpl::onread(const char* ptr, std::size_t len)
 {
+    const auto start = perf::clock::now();
+
     std::string_view data{ptr, len};
     while (!data.empty()) {
         // UTF8 but not SIXEL
@@ -354,6 +523,11 @@ std::size_t TtyImpl::onread(const char* ptr, std::size_t len)
         }
     }
 
+    perf::parsed(perf::clock::now() - start);
+
+    if (m_printer)
+        m_printer->flush();
+
     // return number of bytes not sent
     return data.size();
 }
@@ -382,6 +556,36 @@ void Tty::write(std::string_view data)
     impl->write(data);
 }
 
+void Tty::pastebegin()
+{
+    impl->pastebegin();
+}
+
+void Tty::paste(std::string_view data)
+{
+    impl->paste(data);
+}
+
+void Tty::pasteend()
+{
+    impl->pasteend();
+}
+
+void Tty::pastecancel()
+{
+    impl->pastecancel();
+}
+
+bool Tty::pasting() const
+{
+    return impl->pasting();
+}
+
+std::size_t Tty::pasteroom() const
+{
+    return impl->pasteroom();
+}
+
 void Tty::print(std::string_view data)
 {
     impl->print(data);
@@ -394,6 +598,7 @@ void Tty::hup()
 
 void Tty::read_ready()
 {
+    TRACE_SCOPE("tty read");
     impl->read_ready();
 }
 
@@ -10,6 +10,7 @@
 #include "rwte/rwte.h"
 #include "rwte/selection.h"
 #include "rwte/term.h"
+#include "rwte/trace.h"
 #include "rwte/tty.h"
 #include "rwte/wayland.h"
 #include "rwte/window-internal.h"
@@ -328,10 +329,13 @@ private:
     void iocb();
     void preparecb();
 
-    void paint_pixels(Buffer* buffer);
+    const std::vector<renderer::Rect>& paint_pixels(Buffer* buffer);
 
     int m_resizeReg;
 
+    // the buffer last attached, if it's still around
+    Buffer* m_lastbuffer = nullptr;
+
     uint16_t m_width, m_height;
     uint16_t m_rows, m_cols;
 
@@ -533,11 +537,20 @@ void WlWindow::drawCore()
 
     auto buffer = buffers->get_buffer();
     if (buffer) {
-        paint_pixels(buffer);
+        const auto& rects = paint_pixels(buffer);
 
+        TRACE_SCOPE("buffer commit");
         surface->attach(buffer->get(), 0, 0);
-        surface->damage_buffer(0, 0, m_width, m_height);
+        if (buffer == m_lastbuffer) {
+            for (const auto& r : rects)
+                surface->damage_buffer(r.x, r.y, r.width, r.height);
+        } else {
+            // what was painted is only known relative to what this
+            // buffer held before; the one shown may differ anywhere
+            surface->damage_buffer(0, 0, m_width, m_height);
+        }
         surface->commit();
+        m_lastbuffer = buffer;
     } else {
         LOGGER()->warn("unable to get a draw buffer");
     }
@@ -637,9 +650,10 @@ void WlWindow::onresize(const event::Resize& evt)
     // m_renderer->resize(evt.width, evt.height);
 
     buffers->resize(evt.width, evt.height);
+    m_lastbuffer = nullptr;
 }
 
-void WlWindow::paint_pixels(Buffer* buffer)
+const std::vector<renderer::Rect>& WlWindow::paint_pixels(Buffer* buffer)
 {
     int width = buffer->width();
     int height = buffer->height();
@@ -654,8 +668,9 @@ void WlWindow::paint_pixels(Buffer* buffer)
     m_renderer->set_surface(surface, width, height);
     // todo: this ok? used to be done in onresize?
     m_renderer->resize(width, height);
-    m_renderer->drawregion({0, 0}, {m_rows, m_cols});
+    const auto& rects = m_renderer->drawregion({0, 0}, {m_rows, m_cols});
     m_renderer->set_surface(nullptr, width, height);
+    return rects;
 }
 
 void XdgToplevel::handle_configure(int32_t width, int32_t height,
@@ -0,0 +1,48 @@
+#include "rw/utf8.h"
+#include "rwte/wordclass.h"
+
+#include <algorithm>
+
+namespace screen {
+
+WordClass::WordClass() :
+    m_bmp{}
+{}
+
+WordClass::WordClass(std::string_view delimiters) :
+    m_bmp{}
+{
+    std::vector<char32_t> above;
+    while (!delimiters.empty()) {
+        auto [sz, cp] = utf8decode(delimiters);
+        if (sz == 0)
+            break; // incomplete char
+
+        // nul is never a delimiter; it's what empty cells hold
+        if (cp >= bmp_size)
+            above.push_back(cp);
+        else if (cp != 0)
+            m_bmp[cp / 64] |= uint64_t{1} << (cp % 64);
+
+        delimiters.remove_prefix(sz);
+    }
+
+    // merge runs of codepoints into ranges
+    std::sort(above.begin(), above.end());
+    for (auto cp : above) {
+        if (!m_ranges.empty() && cp <= m_ranges.back().second + 1)
+            m_ranges.back().second = std::max(m_ranges.back().second, cp);
+        else
+            m_ranges.emplace_back(cp, cp);
+    }
+}
+
+bool WordClass::isdelimabove(char32_t c) const
+{
+    // first range ending at or after c
+    auto it = std::lower_bound(m_ranges.begin(), m_ranges.end(), c,
+            [](const auto& range, char32_t c) { return range.second < c; });
+    return it != m_ranges.end() && it->first <= c;
+}
+
+} // namespace screen
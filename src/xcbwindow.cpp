@@ -7,15 +7,21 @@
 #include "rwte/renderer.h"
 #include "rwte/rwte.h"
 #include "rwte/selection.h"
+#include "rwte/seltext.h"
 #include "rwte/term.h"
+#include "rwte/trace.h"
 #include "rwte/tty.h"
 #include "rwte/window-internal.h"
 #include "rwte/window.h"
 
+#include <algorithm>
 #include <cairo/cairo-xcb.h>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <limits.h>
+#include <list>
+#include <optional>
 #include <string_view>
 #include <unistd.h>
 #include <xcb/xcb.h>
@@ -51,6 +57,17 @@ using namespace std::literals;
 #define XEMBED_FOCUS_IN 4
 #define XEMBED_FOCUS_OUT 5
 
+// largest selection sent in one property; bigger ones are sent
+// incrementally, this much at a time
+constexpr std::size_t incr_chunk = 64 * 1024;
+
+// an incr transfer whose requestor hasn't asked for the next chunk in
+// this long is given up on, as ICCCM expects of selection owners
+constexpr auto incr_timeout = 10s;
+
+// most of a pasted selection read at once
+constexpr std::size_t paste_chunk = 64 * 1024;
+
 /// @file
 /// @brief Implements a xcb based window
 
@@ -104,6 +121,7 @@ private:
 
     void publishresize(uint16_t width, uint16_t height);
     void onresize(const event::Resize& evt);
+    void onpasteready(const event::PasteReady& evt);
 
     bool handle_key_press(xcb_key_press_event_t* event);
     bool handle_client_message(xcb_client_message_event_t* event);
@@ -118,11 +136,41 @@ private:
     bool handle_property_notify(xcb_property_notify_event_t* event);
     bool handle_selection_request(xcb_selection_request_event_t* event);
     bool handle_map_notify(xcb_map_notify_event_t* event);
+    bool handle_destroy_notify(xcb_destroy_notify_event_t* event);
     bool handle_expose(xcb_expose_event_t* event);
     bool handle_configure_notify(xcb_configure_notify_event_t* event);
     bool handle_xkb_event(xcb_generic_event_t* gevent);
 
     void selnotify(xcb_atom_t property, bool propnotify);
+    void pumppaste();
+    void endpaste();
+    void setpropwatch();
+
+    // a selection being pasted from a property of our window, read
+    // as the tty has room for it
+    struct Paste
+    {
+        xcb_atom_t property;
+        uint32_t offset; // bytes read of the property
+        bool incr;       // sent in many properties, one after another
+        bool ready;      // the property holds data to read
+    };
+
+    // a selection being sent to a requestor with INCR
+    struct Transfer
+    {
+        xcb_window_t requestor;
+        xcb_atom_t property;
+        xcb_atom_t target;
+        screen::SelectionText text;
+        std::string chunk; // read, but not yet sent
+        std::chrono::steady_clock::time_point sent; // last chunk
+    };
+
+    bool sendincr(xcb_window_t requestor, xcb_atom_t property);
+    void watchrequestor(xcb_window_t requestor, bool watch);
+    void droptransfers(xcb_window_t requestor, bool gone);
+    void expiretransfers();
 
     // helper to call the handlers with their expected args
     template <typename evt_type>
@@ -165,6 +213,7 @@ private:
     std::shared_ptr<Tty> m_tty;
 
     int m_resizeReg;
+    int m_pasteReg;
 
     uint16_t m_width, m_height;
     uint16_t m_rows, m_cols;
@@ -180,6 +229,9 @@ private:
     xcb_atom_t m_xseldata;
     xcb_atom_t m_targets;
 
+    std::list<Transfer> m_transfers;
+    std::optional<Paste> m_paste;
+
     std::unique_ptr<renderer::Renderer> m_renderer;
 
     term::keymod_state m_keymod;
@@ -193,6 +245,7 @@ XcbWindow::XcbWindow(std::shared_ptr<event::Bus> bus,
     m_term(std::move(term)),
     m_tty(std::move(tty)),
     m_resizeReg(m_bus->reg<event::Resize, XcbWindow, &XcbWindow::onresize>(this)),
+    m_pasteReg(m_bus->reg<event::PasteReady, XcbWindow, &XcbWindow::onpasteready>(this)),
     m_eventmask(0)
 {
     int cols = m_term->cols();
@@ -290,6 +343,7 @@ XcbWindow::~XcbWindow()
     xcb_disconnect(connection);
 
     m_bus->unreg<event::Resize>(m_resizeReg);
+    m_bus->unreg<event::PasteReady>(m_pasteReg);
 }
 
 int XcbWindow::fd() const
@@ -300,6 +354,7 @@ int XcbWindow::fd() const
 void XcbWindow::prepare()
 {
     // flush before blocking (and waiting for new events)
+    TRACE_SCOPE("xcb flush");
     xcb_flush(connection);
 }
 
@@ -330,6 +385,10 @@ bool XcbWindow::check()
             LOGGER()->error("X11 Error received! sequence {:#x}, error_code = {}",
                     error->sequence, error->error_code);
             //}
+
+            // a requestor that's gone can't finish its transfers
+            if (error->error_code == XCB_WINDOW)
+                droptransfers(error->resource_id, true);
         } else {
             // clear high bit (indicates generated)
             int type = (event->response_type & 0x7F);
@@ -339,6 +398,9 @@ bool XcbWindow::check()
         std::free(event);
     }
 
+    // requestors that went quiet are noticed as events come in
+    expiretransfers();
+
     return stop;
 }
 
@@ -776,8 +838,13 @@ bool XcbWindow::handle_property_notify(xcb_property_notify_event_t* event)
                 event->state, event->atom, atom_name);
     }
 
-    if (event->state == XCB_PROPERTY_NEW_VALUE &&
-            (event->atom == XCB_ATOM_PRIMARY || event->atom == m_clipboard)) {
+    // a requestor deleting the property asks for the next chunk
+    if (event->state == XCB_PROPERTY_DELETE &&
+            sendincr(event->window, event->atom))
+        return false;
+
+    if (event->state == XCB_PROPERTY_NEW_VALUE && event->window == win &&
+            m_paste && event->atom == m_paste->property) {
         LOGGER()->debug("got clipboard new value");
         selnotify(event->atom, true);
     }
@@ -822,8 +889,7 @@ bool XcbWindow::handle_selection_request(xcb_selection_request_event_t* event)
 
         // with XCB_ATOM_STRING non ascii characters may be incorrect in the
         // requestor. not our problem, use utf8
-        // todo: make stringview, get rid of later strlen
-        std::shared_ptr<char> seltext;
+        std::shared_ptr<const screen::SelectionText> seltext;
         if (event->selection == XCB_ATOM_PRIMARY)
             seltext = m_term->sel().primary;
         else if (event->selection == m_clipboard)
@@ -845,9 +911,40 @@ bool XcbWindow::handle_selection_request(xcb_selection_request_event_t* event)
                 LOGGER()->debug("setting {} property={}",
                         event->requestor, event->property);
 
-            xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
-                    event->requestor, event->property, event->target,
-                    8, std::strlen(seltext.get()), seltext.get());
+            // our own copy, to read from the start
+            auto text = *seltext;
+            text.rewind();
+
+            std::string chunk;
+            if (!text.read(chunk, incr_chunk)) {
+                // small enough to send at once
+                xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
+                        event->requestor, event->property, event->target,
+                        8, chunk.size(), chunk.data());
+            } else {
+                LOGGER()->debug("starting incr transfer to {} property={}",
+                        event->requestor, event->property);
+
+                // a new request for the same property replaces the old
+                m_transfers.remove_if([&](const Transfer& t) {
+                    return t.requestor == event->requestor &&
+                           t.property == event->property;
+                });
+
+                // the incr property's value is a lower bound on the size
+                const uint32_t size = chunk.size();
+                m_transfers.push_back({event->requestor, event->property,
+                        event->target, std::move(text), std::move(chunk),
+                        std::chrono::steady_clock::now()});
+
+                // the requestor deletes the property to ask for data,
+                // which must be watched for before it's set
+                watchrequestor(event->requestor, true);
+
+                xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
+                        event->requestor, event->property, m_incr,
+                        32, 1, &size);
+            }
             property = event->property;
         }
     }
@@ -877,6 +974,13 @@ bool XcbWindow::handle_selection_request(xcb_selection_request_event_t* event)
     return false;
 }
 
+bool XcbWindow::handle_destroy_notify(xcb_destroy_notify_event_t* event)
+{
+    // only selected on requestors of incr transfers
+    droptransfers(event->window, true);
+    return false;
+}
+
 bool XcbWindow::handle_map_notify(xcb_map_notify_event_t* event)
 {
     LOGGER()->info("handle_map_notify");
@@ -906,6 +1010,7 @@ bool XcbWindow::handle_expose(xcb_expose_event_t* event)
 {
     // redraw only on the last expose event in the sequence
     if (event->count == 0 && mapped && visible) {
+        m_renderer->invalidate();
         m_term->setdirty();
         draw();
     }
@@ -1007,6 +1112,7 @@ bool XcbWindow::handle_xcb_event(int type, xcb_generic_event_t* event)
         MESSAGE(XCB_SELECTION_NOTIFY, handle_selection_notify);
         MESSAGE(XCB_SELECTION_REQUEST, handle_selection_request);
         MESSAGE(XCB_MAP_NOTIFY, handle_map_notify);
+        MESSAGE(XCB_DESTROY_NOTIFY, handle_destroy_notify);
 
 #undef MESSAGE
 
@@ -1014,7 +1120,6 @@ bool XcbWindow::handle_xcb_event(int type, xcb_generic_event_t* event)
         case XCB_REPARENT_NOTIFY:   // 21
         case XCB_KEY_RELEASE:       // 3
         case XCB_MAP_REQUEST:       // 20
-        case XCB_DESTROY_NOTIFY:    // 17
         case XCB_ENTER_NOTIFY:      // 7
         case XCB_CONFIGURE_REQUEST: // 23
         case XCB_MAPPING_NOTIFY:    // 34
@@ -1029,60 +1134,213 @@ bool XcbWindow::handle_xcb_event(int type, xcb_generic_event_t* event)
     return false;
 }
 
+bool XcbWindow::sendincr(xcb_window_t requestor, xcb_atom_t property)
+{
+    auto it = std::find_if(m_transfers.begin(), m_transfers.end(),
+            [&](const Transfer& t) {
+                return t.requestor == requestor && t.property == property;
+            });
+    if (it == m_transfers.end())
+        return false;
+
+    auto& t = *it;
+    if (t.chunk.empty())
+        t.text.read(t.chunk, incr_chunk);
+
+    // a zero length chunk ends the transfer
+    xcb_change_property(connection, XCB_PROP_MODE_REPLACE,
+            t.requestor, t.property, t.target,
+            8, t.chunk.size(), t.chunk.data());
+
+    if (t.chunk.empty()) {
+        LOGGER()->debug("finished incr transfer to {} property={}",
+                requestor, property);
+        m_transfers.erase(it);
+
+        bool watched = std::any_of(m_transfers.begin(), m_transfers.end(),
+                [&](const Transfer& o) { return o.requestor == requestor; });
+        if (!watched)
+            watchrequestor(requestor, false);
+    } else {
+        t.chunk.clear();
+        t.sent = std::chrono::steady_clock::now();
+    }
+
+    xcb_flush(connection);
+    return true;
+}
+
+void XcbWindow::watchrequestor(xcb_window_t requestor, bool watch)
+{
+    if (requestor == win) {
+        // our own window, which may be watched for a paste too
+        setpropwatch();
+    } else {
+        // structure changes too, to hear if it's destroyed
+        constexpr uint32_t mask = XCB_CW_EVENT_MASK;
+        constexpr uint32_t watchmask = XCB_EVENT_MASK_PROPERTY_CHANGE |
+                                       XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+        const uint32_t values[1] = {
+                watch ? watchmask : XCB_EVENT_MASK_NO_EVENT};
+        xcb_change_window_attributes(connection, requestor, mask, values);
+    }
+}
+
+void XcbWindow::droptransfers(xcb_window_t requestor, bool gone)
+{
+    const auto before = m_transfers.size();
+    m_transfers.remove_if([&](const Transfer& t) {
+        return t.requestor == requestor;
+    });
+    if (m_transfers.size() == before)
+        return;
+
+    LOGGER()->debug("dropped {} incr transfers to {}",
+            before - m_transfers.size(), requestor);
+
+    // a destroyed window has no events to stop; ours is never gone
+    if (!gone || requestor == win)
+        watchrequestor(requestor, false);
+}
+
+void XcbWindow::expiretransfers()
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = m_transfers.begin(); it != m_transfers.end();) {
+        if (now - it->sent < incr_timeout) {
+            ++it;
+            continue;
+        }
+
+        // drops the rest of that requestor's transfers too, and
+        // restarts the scan
+        LOGGER()->warn("incr transfer to {} timed out", it->requestor);
+        droptransfers(it->requestor, false);
+        it = m_transfers.begin();
+    }
+}
+
 void XcbWindow::selnotify(xcb_atom_t property, bool propnotify)
 {
+    if (propnotify) {
+        // the next chunk of an incr paste
+        if (m_paste && m_paste->incr && property == m_paste->property) {
+            m_paste->offset = 0;
+            m_paste->ready = true;
+            pumppaste();
+        }
+        return;
+    }
+
     if (property == XCB_ATOM_NONE) {
         LOGGER()->debug("got no data");
         return;
     }
 
+    // only the type is needed to start
     xcb_get_property_reply_t* reply = xcb_get_property_reply(connection,
-            xcb_get_property(connection, 0, win, property, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT_MAX), nullptr);
-    if (reply) {
-        std::size_t len = xcb_get_property_value_length(reply);
-        if (propnotify && len == 0) {
-            // propnotify with no data means all data has been
-            // transferred, and we no longer need property
-            // notify events
-            m_eventmask &= ~XCB_EVENT_MASK_PROPERTY_CHANGE;
-
-            constexpr uint32_t mask = XCB_CW_EVENT_MASK;
-            const uint32_t values[1] = {m_eventmask};
-            xcb_change_window_attributes(connection, win, mask, values);
-        }
+            xcb_get_property(connection, 0, win, property, XCB_GET_PROPERTY_TYPE_ANY, 0, 0), nullptr);
+    if (!reply) {
+        LOGGER()->error("unable to get clip property!");
+        return;
+    }
 
-        if (reply->type == m_incr) {
-            // activate property change events so we receive
-            // notification about the next chunk
-            m_eventmask |= XCB_EVENT_MASK_PROPERTY_CHANGE;
-
-            constexpr uint32_t mask = XCB_CW_EVENT_MASK;
-            const uint32_t values[1] = {m_eventmask};
-            xcb_change_window_attributes(connection, win, mask, values);
-
-            // deleting the property is transfer start signal
-            xcb_delete_property(connection, win, property);
-        } else if (len > 0) {
-            char* data = (char*) xcb_get_property_value(reply);
-
-            // fix line endings (\n -> \r)
-            char* repl = data;
-            char* last = data + len;
-            while ((repl = (char*) memchr(repl, '\n', last - repl)))
-                *repl++ = '\r';
-
-            // todo: move to a Term::paste function
-            bool brcktpaste = m_term->mode()[term::MODE_BRCKTPASTE];
-            if (brcktpaste)
-                m_tty->write({"\033[200~", 6});
-            m_tty->write({data, len});
-            if (brcktpaste)
-                m_tty->write({"\033[201~", 6});
+    const bool incr = reply->type == m_incr;
+    std::free(reply);
+
+    if (m_paste)
+        endpaste();
+
+    // todo: move to a Term::paste function
+    m_tty->pastebegin();
+    m_paste = Paste{property, 0, incr, !incr};
+
+    if (incr) {
+        // activate property change events so we receive
+        // notification about the next chunk
+        setpropwatch();
+
+        // deleting the property is transfer start signal
+        xcb_delete_property(connection, win, property);
+    } else
+        pumppaste();
+}
+
+void XcbWindow::pumppaste()
+{
+    while (m_paste && m_paste->ready) {
+        auto& p = *m_paste;
+
+        // a cancelled paste is read to the end, without its data
+        const bool cancelled = !m_tty->pasting();
+        if (!cancelled && m_tty->pasteroom() < paste_chunk)
+            return; // until PasteReady
+
+        // offset and length are in 32 bit units
+        const uint32_t length = cancelled ? 0 : paste_chunk / 4;
+        xcb_get_property_reply_t* reply = xcb_get_property_reply(connection,
+                xcb_get_property(connection, 0, win, p.property, XCB_GET_PROPERTY_TYPE_ANY, p.offset / 4, length), nullptr);
+        if (!reply) {
+            LOGGER()->error("unable to get clip property!");
+            // ended first, so the cancel's PasteReady finds no paste
+            endpaste();
+            m_tty->pastecancel();
+            return;
         }
 
+        const std::size_t len = xcb_get_property_value_length(reply);
+        const bool empty = p.offset == 0 && len == 0 && reply->bytes_after == 0;
+        const bool last = cancelled || reply->bytes_after == 0;
+        if (!cancelled && len > 0)
+            m_tty->paste({static_cast<const char*>(xcb_get_property_value(reply)), len});
+        p.offset += len;
         std::free(reply);
-    } else
-        LOGGER()->error("unable to get clip property!");
+
+        if (last) {
+            // with incr, deleting the property asks for the next
+            xcb_delete_property(connection, win, p.property);
+
+            // an empty property ends an incr transfer
+            if (!p.incr || empty) {
+                m_tty->pasteend();
+                endpaste();
+            } else
+                p.ready = false;
+        }
+    }
+
+    xcb_flush(connection);
+}
+
+void XcbWindow::endpaste()
+{
+    m_paste.reset();
+    setpropwatch();
+}
+
+void XcbWindow::setpropwatch()
+{
+    // property changes on our window are wanted by incr pastes, and
+    // by incr transfers to ourselves
+    const bool watch = (m_paste && m_paste->incr) ||
+                       std::any_of(m_transfers.begin(), m_transfers.end(),
+                               [&](const Transfer& t) { return t.requestor == win; });
+
+    const uint32_t eventmask = watch ?
+            m_eventmask | XCB_EVENT_MASK_PROPERTY_CHANGE :
+            m_eventmask & ~XCB_EVENT_MASK_PROPERTY_CHANGE;
+    if (eventmask == m_eventmask)
+        return;
+    m_eventmask = eventmask;
+
+    constexpr uint32_t mask = XCB_CW_EVENT_MASK;
+    const uint32_t values[1] = {m_eventmask};
+    xcb_change_window_attributes(connection, win, mask, values);
+}
+
+void XcbWindow::onpasteready(const event::PasteReady& evt)
+{
+    pumppaste();
 }
 
 } // namespace xcbwin
@@ -0,0 +1,139 @@
+#include "doctest.h"
+#include "rwte/asyncio.h"
+
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+class FakeCtrl : public reactor::ReactorCtrl
+{
+public:
+    void set_write(int fd, bool write) { writing = write; }
+    void unreg(int fd) {}
+
+    void queue_refresh(float secs) {}
+    void start_repeat(float secs) {}
+    void stop_repeat() {}
+    void start_blink(float secs) {}
+    void stop_blink() {}
+    void start_sync(float secs) {}
+    void stop_sync() {}
+
+    bool writing = false;
+};
+
+// writes to the write end of a pipe, a few bytes at a time
+class PipeIO : public AsyncIO<PipeIO, 4>
+{
+public:
+    explicit PipeIO(FakeCtrl* ctrl) :
+        AsyncIO<PipeIO, 4>(ctrl)
+    {
+        int fds[2];
+        REQUIRE(pipe(fds) == 0);
+        m_read = fds[0];
+        fcntl(m_read, F_SETFL, O_NONBLOCK);
+        setFd(fds[1]);
+    }
+
+    ~PipeIO() { close(m_read); }
+
+    // everything written since the last call
+    std::string written()
+    {
+        std::string out;
+        char buf[256];
+        ssize_t n;
+        while ((n = ::read(m_read, buf, sizeof(buf))) > 0)
+            out.append(buf, n);
+        return out;
+    }
+
+    std::vector<std::size_t> low;
+
+private:
+    friend class AsyncIO<PipeIO, 4>;
+    void log_write(bool initial, const char* data, size_t len) {}
+    void log_buffered(size_t len) {}
+    void log_low(size_t len) { low.push_back(len); }
+    std::size_t onread(const char* ptr, std::size_t len) { return 0; }
+
+    int m_read;
+};
+
+} // namespace
+
+TEST_SUITE_BEGIN("asyncio");
+
+TEST_CASE("low priority writes")
+{
+    FakeCtrl ctrl;
+    PipeIO io(&ctrl);
+
+    SUBCASE("wait for write_ready")
+    {
+        io.writelow("hello");
+        CHECK(ctrl.writing);
+        CHECK(io.written().empty());
+        CHECK(io.lowpending() == 5);
+
+        io.write_ready();
+        io.write_ready();
+        CHECK(io.written() == "hello");
+        CHECK(io.lowpending() == 0);
+        CHECK(!ctrl.writing);
+        CHECK(io.low == std::vector<std::size_t>{1, 0});
+    }
+
+    SUBCASE("go after normal writes")
+    {
+        io.writelow("abcdefgh");
+        io.write_ready();
+        io.write("12345678");
+        CHECK(io.written() == "abcd1234");
+
+        io.write_ready();
+        io.write_ready();
+        io.write_ready();
+        CHECK(io.written() == "5678efgh");
+        CHECK(!ctrl.writing);
+    }
+
+    SUBCASE("aren't interrupted inside a character")
+    {
+        // the first write ends partway through the é
+        io.writelow("abc\xc3\xa9xyzw");
+        io.write_ready();
+        io.write("1");
+        io.write_ready();
+        io.write_ready();
+        io.write_ready();
+        CHECK(io.written() == "abc\xc3\xa9xyz1w");
+    }
+
+    SUBCASE("can be dropped")
+    {
+        io.writelow("abc");
+        const auto at = io.lowqueued();
+        io.writelow("\xc3\xa9xyz");
+        CHECK(io.lowqueued() == 8);
+
+        // from an unwritten position, nothing written is lost
+        io.droplow(at);
+        CHECK(io.lowpending() == 3);
+        CHECK(io.lowqueued() == 3);
+
+        // from a written position, the rest of a character is kept
+        io.writelow("\xc3\xa9xyz");
+        io.write_ready();
+        io.droplow(0);
+        CHECK(io.lowpending() == 1);
+        io.write_ready();
+        CHECK(io.written() == "abc\xc3\xa9");
+        CHECK(!ctrl.writing);
+    }
+}
+
+TEST_SUITE_END();
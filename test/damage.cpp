@@ -0,0 +1,101 @@
+#include "doctest.h"
+#include "rwte/damage.h"
+
+using renderer::Damage;
+using renderer::Rect;
+
+TEST_SUITE_BEGIN("damage");
+
+TEST_CASE("damage rects")
+{
+    Damage d;
+    CHECK(d.empty());
+
+    SUBCASE("empty rects are skipped")
+    {
+        d.add({5, 5, 0, 10});
+        d.add({5, 5, 10, -1});
+        CHECK(d.empty());
+    }
+
+    SUBCASE("runs on a row join")
+    {
+        d.add({0, 0, 10, 20});
+        d.add({10, 0, 30, 20});
+        d.add({40, 0, 10, 20});
+        REQUIRE(d.rects().size() == 1);
+        CHECK(d.rects()[0] == Rect{0, 0, 50, 20});
+    }
+
+    SUBCASE("rows join into a band")
+    {
+        for (int row = 0; row < 10; row++)
+            d.add({0, row * 20, 100, 20});
+        REQUIRE(d.rects().size() == 1);
+        CHECK(d.rects()[0] == Rect{0, 0, 100, 200});
+    }
+
+    SUBCASE("rows join once they're whole")
+    {
+        d.add({0, 0, 50, 20});
+        d.add({0, 20, 100, 20});
+        CHECK(d.rects().size() == 2);
+
+        // finishing the first row joins both
+        d.add({50, 0, 50, 20});
+        REQUIRE(d.rects().size() == 1);
+        CHECK(d.rects()[0] == Rect{0, 0, 100, 40});
+    }
+
+    SUBCASE("rects inside others are taken in")
+    {
+        d.add({0, 0, 100, 100});
+        d.add({10, 10, 5, 5});
+        REQUIRE(d.rects().size() == 1);
+        CHECK(d.rects()[0] == Rect{0, 0, 100, 100});
+
+        d.add({-10, -10, 200, 200});
+        REQUIRE(d.rects().size() == 1);
+        CHECK(d.rects()[0] == Rect{-10, -10, 200, 200});
+    }
+
+    SUBCASE("apart rects are kept apart")
+    {
+        d.add({0, 0, 10, 10});
+        d.add({50, 50, 10, 10});
+        CHECK(d.rects().size() == 2);
+        CHECK(d.bounds() == Rect{0, 0, 60, 60});
+    }
+
+    SUBCASE("the count is bounded")
+    {
+        // a cell on every other row, a long way apart
+        for (int i = 0; i < 20; i++)
+            d.add({(i % 2) * 500, i * 40, 10, 20});
+
+        CHECK(d.rects().size() <= Damage::max_rects);
+        CHECK(d.bounds() == Rect{0, 0, 510, 780});
+
+        // everything added is still covered
+        for (int i = 0; i < 20; i++) {
+            const Rect r{(i % 2) * 500, i * 40, 10, 20};
+            bool covered = false;
+            for (const auto& e : d.rects()) {
+                covered = covered || (e.x <= r.x && e.y <= r.y &&
+                                             r.x + r.width <= e.x + e.width &&
+                                             r.y + r.height <= e.y + e.height);
+            }
+            CHECK(covered);
+        }
+    }
+
+    SUBCASE("clear")
+    {
+        d.add({0, 0, 10, 10});
+        d.clear();
+        CHECK(d.empty());
+        CHECK(d.bounds().empty());
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,40 @@
+#include "doctest.h"
+#include "rwte/headless.h"
+
+TEST_SUITE_BEGIN("headless");
+
+TEST_CASE("headless frames")
+{
+    headless::Headless h{80, 24};
+
+    // the blank screen's first frame
+    h.present();
+    const auto frames = h.frames();
+
+    SUBCASE("a refresh is queued for the timer")
+    {
+        h.feed("hello");
+        CHECK(h.refreshqueued());
+        CHECK_FALSE(h.drawqueued());
+        CHECK(h.present());
+        CHECK(h.frames() == frames + 1);
+        CHECK_FALSE(h.present());
+    }
+
+    SUBCASE("a synchronized update is one frame, drawn at its end")
+    {
+        h.feed("\033[?2026h");
+        h.feed("one\r\n");
+        h.feed("two\r\n");
+        CHECK_FALSE(h.refreshqueued());
+        CHECK_FALSE(h.drawqueued());
+
+        h.feed("\033[?2026l");
+        CHECK(h.drawqueued());
+        CHECK(h.present());
+        CHECK(h.frames() == frames + 1);
+        CHECK_FALSE(h.present());
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,149 @@
+#include "doctest.h"
+#include "rwte/history.h"
+
+// a row whose glyphs encode n, with a blank run on the end
+static screen::screenRow numberedRow(int n, int cols = 40)
+{
+    screen::screenRow row(cols);
+    for (int col = 0; col < cols / 2; col++) {
+        row[col].u = 'a' + (n + col) % 26;
+        row[col].fg = n;
+        row[col].bg = col < 4 ? 1 : 2;
+        row[col].attr.bold = n & 1;
+    }
+    return row;
+}
+
+static bool sameRow(const screen::screenRow& a, const screen::screenRow& b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (std::size_t i = 0; i < a.size(); i++) {
+        if (a[i].u != b[i].u || a[i].attr != b[i].attr ||
+                a[i].fg != b[i].fg || a[i].bg != b[i].bg)
+            return false;
+    }
+
+    return true;
+}
+
+TEST_CASE("history keeps nothing by default")
+{
+    screen::History history;
+    history.push(numberedRow(0));
+    CHECK(history.size() == 0);
+}
+
+TEST_CASE("history in memory")
+{
+    screen::History history;
+    history.configure({10, false, 0});
+
+    for (int i = 0; i < 25; i++)
+        history.push(numberedRow(i));
+
+    SUBCASE("drops the oldest lines")
+    {
+        CHECK(history.size() == 10);
+        CHECK(sameRow(history.line(0), numberedRow(15)));
+        CHECK(sameRow(history.line(9), numberedRow(24)));
+    }
+
+    SUBCASE("out of range lines are empty")
+    {
+        CHECK(history.line(10).empty());
+    }
+
+    SUBCASE("pop takes back the newest line")
+    {
+        screen::screenRow row;
+        REQUIRE(history.pop(row));
+        CHECK(sameRow(row, numberedRow(24)));
+        CHECK(history.size() == 9);
+
+        history.push(numberedRow(99));
+        CHECK(history.size() == 10);
+        CHECK(sameRow(history.line(0), numberedRow(15)));
+        CHECK(sameRow(history.line(9), numberedRow(99)));
+    }
+
+    SUBCASE("clear empties it")
+    {
+        history.clear();
+        CHECK(history.size() == 0);
+
+        history.push(numberedRow(3));
+        CHECK(history.size() == 1);
+        CHECK(sameRow(history.line(0), numberedRow(3)));
+    }
+}
+
+TEST_CASE("history spilled to disk")
+{
+    // enough lines to fill a number of blocks
+    const int lines = 20000;
+
+    screen::History history;
+    history.configure({lines, true, 100});
+
+    for (int i = 0; i < lines; i++)
+        history.push(numberedRow(i));
+
+    SUBCASE("keeps every line")
+    {
+        REQUIRE(history.size() == lines);
+        CHECK(history.spillsize() > 0);
+
+        bool same = true;
+        for (int i = 0; i < lines; i++)
+            same = same && sameRow(history.line(i), numberedRow(i));
+        CHECK(same);
+    }
+
+    SUBCASE("reads lines in any order")
+    {
+        CHECK(sameRow(history.line(lines - 1), numberedRow(lines - 1)));
+        CHECK(sameRow(history.line(0), numberedRow(0)));
+        CHECK(sameRow(history.line(lines / 2), numberedRow(lines / 2)));
+        CHECK(sameRow(history.line(lines - 101), numberedRow(lines - 101)));
+    }
+
+    SUBCASE("drops whole blocks once past the limit")
+    {
+        for (int i = lines; i < 2 * lines; i++)
+            history.push(numberedRow(i));
+
+        const auto size = history.size();
+        CHECK(size >= lines);
+        CHECK(size < lines + 2000);
+
+        const int first = 2 * lines - size;
+        CHECK(sameRow(history.line(0), numberedRow(first)));
+        CHECK(sameRow(history.line(size - 1), numberedRow(2 * lines - 1)));
+    }
+
+    SUBCASE("pops back through spilled lines")
+    {
+        screen::screenRow row;
+        bool same = true;
+        for (int i = lines - 1; i >= lines - 3000; i--)
+            same = history.pop(row) && same && sameRow(row, numberedRow(i));
+        CHECK(same);
+        CHECK(history.size() == lines - 3000);
+
+        for (int i = lines - 3000; i < lines; i++)
+            history.push(numberedRow(i));
+        CHECK(sameRow(history.line(lines - 3000), numberedRow(lines - 3000)));
+        CHECK(sameRow(history.line(lines - 1), numberedRow(lines - 1)));
+    }
+
+    SUBCASE("keeps memory flat")
+    {
+        const auto mem = history.memsize();
+        for (int i = lines; i < 2 * lines; i++)
+            history.push(numberedRow(i));
+
+        CHECK(history.memsize() < mem + 4096);
+    }
+}
@@ -0,0 +1,144 @@
+#include "doctest.h"
+#include "rwte/printlog.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+
+using namespace std::literals;
+
+namespace {
+
+// a temp dir, removed with what's in it
+class TempDir
+{
+public:
+    TempDir()
+    {
+        char tmpl[] = "/tmp/rwte-test-XXXXXX";
+        REQUIRE(mkdtemp(tmpl));
+        path = tmpl;
+    }
+
+    ~TempDir()
+    {
+        const auto cmd = "rm -rf " + path;
+        std::system(cmd.c_str());
+    }
+
+    std::string path;
+};
+
+// the file's contents, or "none" if it doesn't exist
+std::string slurp(const std::string& path)
+{
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+        return "none";
+    return {std::istreambuf_iterator<char>(in),
+            std::istreambuf_iterator<char>()};
+}
+
+// prints data to path through a writer of its own, which is gone,
+// with everything written, by the time this returns
+void printto(const std::string& path, const printlog::Options& opts,
+        const std::string& data)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0666);
+    REQUIRE(fd >= 0);
+
+    printlog::Writer w{fd, path, opts};
+    w.print(data);
+    w.flush();
+}
+
+} // namespace
+
+TEST_SUITE_BEGIN("printlog");
+
+TEST_CASE("rotation")
+{
+    TempDir dir;
+    const auto path = dir.path + "/out";
+
+    printlog::Options opts;
+    opts.rotate_bytes = 10;
+
+    SUBCASE("under the size, nothing rotates")
+    {
+        printto(path, opts, "short");
+        CHECK(slurp(path) == "short");
+        CHECK(slurp(path + ".1") == "none");
+    }
+
+    SUBCASE("past the size, the file moves aside")
+    {
+        printto(path, opts, "0123456789ab");
+        CHECK(slurp(path) == "");
+        CHECK(slurp(path + ".1") == "0123456789ab");
+    }
+
+    SUBCASE("keeps only keep files")
+    {
+        opts.keep = 2;
+        printto(path, opts, "first-----");
+        printto(path, opts, "second----");
+        printto(path, opts, "third-----");
+        CHECK(slurp(path + ".1") == "third-----");
+        CHECK(slurp(path + ".2") == "second----");
+        CHECK(slurp(path + ".3") == "none");
+    }
+}
+
+TEST_CASE("back-pressure")
+{
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+    const int rd = fds[0];
+
+    printlog::Options opts;
+    opts.max_pending = 1024;
+
+    // far more than the pipe holds, so the writer blocks on it
+    const std::string big(256 * 1024, 'x');
+
+    auto w = std::make_unique<printlog::Writer>(fds[1], "", opts);
+    auto printing = std::async(std::launch::async, [&] {
+        w->print(big);
+        w->flush();
+
+        // what the writer has taken counts against max_pending, so
+        // this waits until it's written
+        w->print("y");
+        w->flush();
+    });
+
+    CHECK(printing.wait_for(100ms) == std::future_status::timeout);
+
+    // drain the pipe, letting the writer and print go on
+    std::string got;
+    char buf[4096];
+    pollfd pfd{rd, POLLIN, 0};
+    while (got.size() < big.size() + 1 && poll(&pfd, 1, 1000) > 0) {
+        const ssize_t n = read(rd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        got.append(buf, n);
+    }
+
+    printing.get();
+    w.reset();
+    close(rd);
+
+    CHECK(got.size() == big.size() + 1);
+    CHECK(got.back() == 'y');
+}
+
+TEST_SUITE_END();
@@ -1,7 +1,10 @@
 #include "doctest.h"
 #include "fmt/core.h"
+#include "rwte/history.h"
 #include "rwte/screen.h"
 
+#include <utility>
+
 class ScreenFixture
 {
 public:
@@ -179,8 +182,12 @@ TEST_CASE_FIXTURE(ScreenFixture, "resize resizes")
             for (cell.col = 0; cell.col < 3; cell.col++) {
                 const auto g = screen.glyph(cell);
 
+                // the first row's line is rewrapped onto the second
+                auto attr = this->initial_fill.attr;
+                attr.wrap = cell.row == 0 && cell.col == 2;
+
                 REQUIRE(g.u == this->initial_fill.u);
-                REQUIRE(g.attr == this->initial_fill.attr);
+                REQUIRE(g.attr == attr);
                 REQUIRE(g.fg == this->initial_fill.fg);
                 REQUIRE(g.bg == this->initial_fill.bg);
             }
@@ -230,6 +237,107 @@ TEST_CASE_FIXTURE(ScreenFixture, "resize resizes")
     }
 }
 
+// writes text from the cursor, wrapping like the terminal does
+static void writeText(screen::Screen& screen, const std::u32string& text)
+{
+    for (auto u : text) {
+        auto cursor = screen.cursor();
+        if (cursor.state & screen::CURSOR_WRAPNEXT) {
+            screen.glyph(cursor).attr.wrap = 1;
+            screen.newline(true);
+            cursor = screen.cursor();
+        }
+
+        screen.glyph(cursor) = {u, {}, 0, 0};
+        if (cursor.col + 1 < screen.cols())
+            cursor.col++;
+        else
+            cursor.state |= screen::CURSOR_WRAPNEXT;
+        screen.setCursor(cursor);
+    }
+}
+
+static std::u32string rowText(const screen::Screen& screen, int row)
+{
+    std::u32string text;
+    for (int col = 0; col < screen.cols(); col++)
+        text.push_back(screen.glyph({row, col}).u);
+    return text;
+}
+
+TEST_CASE("resize reflows wrapped lines")
+{
+    auto bus = std::make_shared<event::Bus>();
+    screen::Screen screen{bus};
+    screen.resize(4, 4);
+    screen.setscroll(0, 3);
+
+    writeText(screen, U"abcdef");
+    screen.newline(true);
+    writeText(screen, U"gh");
+
+    SUBCASE("narrower wraps lines")
+    {
+        screen.resize(3, 4);
+        CHECK(rowText(screen, 0) == U"abc");
+        CHECK(rowText(screen, 1) == U"def");
+        CHECK(rowText(screen, 2) == U"gh ");
+        CHECK(screen.glyph({0, 2}).attr.wrap);
+        CHECK(!screen.glyph({1, 2}).attr.wrap);
+
+        CHECK(screen.cursor().row == 2);
+        CHECK(screen.cursor().col == 2);
+    }
+
+    SUBCASE("wider joins lines")
+    {
+        screen.resize(8, 4);
+        CHECK(rowText(screen, 0) == U"abcdef  ");
+        CHECK(rowText(screen, 1) == U"gh      ");
+        CHECK(!screen.glyph({0, 7}).attr.wrap);
+
+        CHECK(screen.cursor().row == 1);
+        CHECK(screen.cursor().col == 2);
+    }
+
+    SUBCASE("and back again")
+    {
+        screen.resize(2, 6);
+        screen.resize(4, 6);
+        CHECK(rowText(screen, 0) == U"abcd");
+        CHECK(rowText(screen, 1) == U"ef  ");
+        CHECK(rowText(screen, 2) == U"gh  ");
+    }
+
+    SUBCASE("keeps the cursor on screen")
+    {
+        // the top rows are dropped, as there's no history here. the
+        // cursor, just past "gh", moves on to the row below it.
+        screen.resize(2, 3);
+        CHECK(rowText(screen, 0) == U"ef");
+        CHECK(rowText(screen, 1) == U"gh");
+
+        CHECK(screen.cursor().row == 2);
+        CHECK(screen.cursor().col == 0);
+    }
+
+    SUBCASE("doesn't split wide glyphs")
+    {
+        screen.clear();
+        screen.setCursor({});
+        writeText(screen, U"ab");
+        auto cursor = screen.cursor();
+        screen.glyph(cursor) = {U'中', {.wide = 1}, 0, 0};
+        screen.glyph({cursor.row, cursor.col + 1}) = {0, {.wdummy = 1}, 0, 0};
+
+        screen.resize(3, 4);
+        CHECK(rowText(screen, 0) == U"ab ");
+        CHECK(screen.glyph({0, 2}).attr.wrap);
+        CHECK(screen.glyph({1, 0}).attr.wide);
+        CHECK(screen.glyph({1, 1}).attr.wdummy);
+    }
+}
+
 TEST_CASE_FIXTURE(ScreenFixture, "clear clears")
 {
     auto checkRange = [this](
@@ -488,6 +596,53 @@ TEST_CASE_FIXTURE(ScreenFixtureVarying, "deleteline removes lines")
     }
 }
 
+namespace {
+
+// counts HistoryPush events
+struct PushCount
+{
+    void onpush(const event::HistoryPush& evt) { n++; }
+    int n = 0;
+};
+
+} // namespace
+
+TEST_CASE_FIXTURE(ScreenFixtureVarying, "only scrolled lines go to history")
+{
+    screen::History::Options opts;
+    opts.max_lines = 100;
+    screen.history().configure(opts);
+
+    PushCount pushes;
+    const int reg = bus->reg<event::HistoryPush, PushCount, &PushCount::onpush>(&pushes);
+
+    auto c = screen.cursor();
+    c.row = 0;
+    screen.setCursor(c);
+
+    SUBCASE("deleted lines are dropped")
+    {
+        screen.deleteline(2);
+        CHECK(screen.history().size() == 0);
+        CHECK(pushes.n == 0);
+    }
+
+    SUBCASE("lines scrolled off the top are kept")
+    {
+        screen.scrollup(0, 2);
+        CHECK(screen.history().size() == 2);
+        CHECK(pushes.n == 1);
+
+        c.row = initial_rows - 1;
+        screen.setCursor(c);
+        screen.newline(true);
+        CHECK(screen.history().size() == 3);
+        CHECK(pushes.n == 2);
+    }
+
+    bus->unreg<event::HistoryPush>(reg);
+}
+
 TEST_CASE_FIXTURE(ScreenFixtureVarying, "insertblankline adds lines")
 {
     SUBCASE("inserts one line")
@@ -578,4 +733,135 @@ TEST_CASE_FIXTURE(ScreenFixtureVarying, "insertblank adds chars at cursor")
     // inserts two at end
 }
 
+TEST_CASE_FIXTURE(ScreenFixture, "blink counts track writes")
+{
+    screen::Glyph blinking = initial_fill;
+    blinking.attr.blink = 1;
+
+    REQUIRE(screen.blinkcount() == 0);
+
+    screen.setGlyph({1, 1}, blinking);
+    screen.setGlyph({1, 3}, blinking);
+    screen.setGlyph({3, 0}, blinking);
+    REQUIRE(screen.blinkcount() == 3);
+    REQUIRE(screen.blinkcount(1) == 2);
+    REQUIRE(screen.blinkcount(3) == 1);
+
+    SUBCASE("overwriting a blinking glyph")
+    {
+        screen.setGlyph({1, 1}, initial_fill);
+        REQUIRE(screen.blinkcount() == 2);
+        REQUIRE(screen.blinkcount(1) == 1);
+    }
+
+    SUBCASE("clearing")
+    {
+        screen.clear({1, 0}, {1, initial_cols - 1});
+        REQUIRE(screen.blinkcount() == 1);
+        REQUIRE(screen.blinkcount(1) == 0);
+    }
+
+    SUBCASE("scrolling moves counts with rows")
+    {
+        screen.scrollup(0, 1);
+        REQUIRE(screen.blinkcount() == 3);
+        REQUIRE(screen.blinkcount(0) == 2);
+        REQUIRE(screen.blinkcount(2) == 1);
+
+        screen.scrollup(0, 1);
+        REQUIRE(screen.blinkcount() == 1);
+        REQUIRE(screen.blinkcount(1) == 1);
+    }
+
+    SUBCASE("alternate screen has its own count")
+    {
+        screen.swapscreen();
+        REQUIRE(screen.blinkcount() == 0);
+        screen.swapscreen();
+        REQUIRE(screen.blinkcount() == 3);
+    }
+}
+
+TEST_CASE_FIXTURE(ScreenFixture, "alternate screen is allocated while used")
+{
+    const auto primary = screen.memsize();
+
+    screen.swapscreen();
+    const auto both = screen.memsize();
+    REQUIRE(both > primary);
+    REQUIRE(screen.glyph({0, 0}).u == screen::empty_char);
+
+    SUBCASE("content is kept while it's hidden")
+    {
+        screen.setGlyph({1, 1}, initial_fill);
+        screen.swapscreen();
+        screen.scrollup(0, 1);
+        screen.swapscreen();
+        CHECK(screen.glyph({1, 1}).u == initial_fill.u);
+    }
+
+    SUBCASE("a blank hidden screen is released on scroll")
+    {
+        screen.swapscreen();
+        screen.scrollup(0, 1);
+        CHECK(screen.memsize() < both);
+    }
+
+    SUBCASE("a blank hidden screen is released on resize, and comes back")
+    {
+        screen.clear();
+        screen.swapscreen();
+        screen.resize(initial_cols + 1, initial_rows);
+        CHECK(screen.memsize() < both);
+        CHECK(screen.glyph({0, 0}).u == initial_fill.u);
+
+        // with the cells it was cleared to, at the new size
+        screen.swapscreen();
+        CHECK(screen.lines()[0].size() == initial_cols + 1);
+        CHECK(screen.glyph({0, initial_cols}).u == screen::empty_char);
+        CHECK(screen.glyph({0, initial_cols}).fg == second_fill.fg);
+        CHECK(screen.glyph({0, initial_cols}).bg == second_fill.bg);
+    }
+}
+
+TEST_CASE_FIXTURE(ScreenFixtureVarying, "snapshot is isolated from writes")
+{
+    const auto view = screen.snapshot();
+    REQUIRE(view.rows() == initial_rows);
+    REQUIRE(view.cols() == initial_cols);
+
+    SUBCASE("glyph writes don't reach snapshot")
+    {
+        screen.setGlyph({1, 2}, initial_fill);
+        REQUIRE(screen.glyph({1, 2}).u == initial_fill.u);
+
+        const auto g = view.glyph({1, 2});
+        REQUIRE(g.u == glyphForCell({1, 2}).u);
+    }
+
+    SUBCASE("untouched rows are shared")
+    {
+        screen.setGlyph({1, 2}, initial_fill);
+
+        // only the written row is cloned
+        REQUIRE(&view.line(0) == &std::as_const(screen).line(0));
+        REQUIRE(&view.line(1) != &std::as_const(screen).line(1));
+    }
+
+    SUBCASE("scrolling doesn't reach snapshot")
+    {
+        screen.scrollup(0, 2);
+
+        Cell cell;
+        for (cell.row = 0; cell.row < initial_rows; cell.row++) {
+            for (cell.col = 0; cell.col < initial_cols; cell.col++) {
+                const auto g = view.glyph(cell);
+                REQUIRE(g.u == glyphForCell(cell).u);
+                REQUIRE(g.fg == glyphForCell(cell).fg);
+                REQUIRE(g.bg == glyphForCell(cell).bg);
+            }
+        }
+    }
+}
+
 TEST_SUITE_END();
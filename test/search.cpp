@@ -0,0 +1,115 @@
+#include "doctest.h"
+#include "rwte/history.h"
+#include "rwte/search.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace std::literals;
+
+static screen::screenRow textRow(const char* text, int cols = 40)
+{
+    screen::screenRow row(cols);
+    for (int col = 0; col < cols && text[col]; col++)
+        row[col].u = text[col];
+    return row;
+}
+
+TEST_CASE("findrow")
+{
+    std::vector<search::Match> found;
+
+    SUBCASE("finds every match")
+    {
+        search::findrow(textRow("an apple, a pear and an apple"), "apple", 7,
+                found);
+        REQUIRE(found.size() == 2);
+        CHECK(found[0].line == 7);
+        CHECK(found[0].col == 3);
+        CHECK(found[0].len == 5);
+        CHECK(found[1].col == 24);
+    }
+
+    SUBCASE("lowercase patterns ignore case")
+    {
+        search::findrow(textRow("Apple APPLE"), "apple", 0, found);
+        CHECK(found.size() == 2);
+    }
+
+    SUBCASE("uppercase patterns match case")
+    {
+        search::findrow(textRow("Apple APPLE"), "APPLE", 0, found);
+        REQUIRE(found.size() == 1);
+        CHECK(found[0].col == 6);
+    }
+
+    SUBCASE("wide glyphs count as their cells")
+    {
+        auto row = textRow("xx  apple");
+        row[0].u = U'中';
+        row[0].attr.wide = 1;
+        row[1].u = 0;
+        row[1].attr.wdummy = 1;
+        search::findrow(row, "apple", 0, found);
+        REQUIRE(found.size() == 1);
+        CHECK(found[0].col == 4);
+    }
+
+    SUBCASE("empty pattern finds nothing")
+    {
+        search::findrow(textRow("apple"), "", 0, found);
+        CHECK(found.empty());
+    }
+}
+
+TEST_CASE("search of history")
+{
+    screen::History history;
+    history.configure({100, false, 0});
+    for (int i = 0; i < 50; i++)
+        history.push(textRow(i % 10 == 3 ? "needle here" : "hay"));
+
+    search::Search search{history};
+    search.start("needle");
+
+    // the history is scanned in the background
+    for (int i = 0; i < 200 && search.count() < 5; i++)
+        std::this_thread::sleep_for(5ms);
+    REQUIRE(search.count() == 5);
+
+    SUBCASE("finds the nearest match up")
+    {
+        auto m = search.find(history.total(), 0, -1);
+        REQUIRE(m);
+        CHECK(m->line == 43);
+
+        m = search.find(m->line, m->col, -1);
+        REQUIRE(m);
+        CHECK(m->line == 33);
+    }
+
+    SUBCASE("finds the nearest match down")
+    {
+        auto m = search.find(0, -1, 1);
+        REQUIRE(m);
+        CHECK(m->line == 3);
+
+        CHECK(!search.find(43, 0, 1));
+    }
+
+    SUBCASE("picks up new lines")
+    {
+        history.push(textRow("a needle"));
+        search.pushed();
+        for (int i = 0; i < 200 && search.count() < 6; i++)
+            std::this_thread::sleep_for(5ms);
+        CHECK(search.count() == 6);
+    }
+
+    SUBCASE("a new pattern drops old matches")
+    {
+        search.start("nothing");
+        CHECK(search.count() == 0);
+        CHECK(!search.find(history.total(), 0, -1));
+    }
+}
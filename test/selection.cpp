@@ -0,0 +1,144 @@
+#include "doctest.h"
+#include "rwte/selection.h"
+#include "rwte/seltext.h"
+
+static Selection makeSelection(Cell nb, Cell ne, bool rectangular = false)
+{
+    Selection sel;
+    sel.begin(nb);
+    sel.setmode(Selection::Mode::Ready);
+    sel.setrectangular(rectangular);
+    sel.oe = ne;
+    sel.nb = nb;
+    sel.ne = ne;
+    return sel;
+}
+
+TEST_SUITE_BEGIN("selection");
+
+TEST_CASE("selection spans")
+{
+    std::vector<int> changed;
+
+    SUBCASE("spans follow the selected cells")
+    {
+        auto sel = makeSelection({1, 3}, {3, 2});
+        sel.updatespans(5, 10, changed);
+        CHECK(changed == std::vector<int>{1, 2, 3});
+
+        CHECK(sel.span(0).empty());
+        CHECK(sel.span(1) == Selection::Span{3, 10});
+        CHECK(sel.span(2) == Selection::Span{0, 10});
+        CHECK(sel.span(3) == Selection::Span{0, 3});
+        CHECK(sel.span(4).empty());
+
+        Cell cell;
+        for (cell.row = 0; cell.row < 5; cell.row++) {
+            for (cell.col = 0; cell.col < 10; cell.col++)
+                CHECK(sel.span(cell.row).contains(cell.col) ==
+                        sel.selected(cell));
+        }
+    }
+
+    SUBCASE("rectangular spans")
+    {
+        auto sel = makeSelection({1, 3}, {3, 5}, true);
+        sel.updatespans(5, 10, changed);
+        CHECK(sel.span(1) == Selection::Span{3, 6});
+        CHECK(sel.span(2) == Selection::Span{3, 6});
+        CHECK(sel.span(3) == Selection::Span{3, 6});
+    }
+
+    SUBCASE("only changed rows are reported")
+    {
+        auto sel = makeSelection({1, 3}, {3, 2});
+        sel.updatespans(5, 10, changed);
+
+        changed.clear();
+        sel.ne = sel.oe = {3, 6};
+        sel.updatespans(5, 10, changed);
+        CHECK(changed == std::vector<int>{3});
+
+        changed.clear();
+        sel.clear();
+        sel.updatespans(5, 10, changed);
+        CHECK(changed == std::vector<int>{1, 2, 3});
+    }
+
+    SUBCASE("anyselected checks overlap")
+    {
+        auto sel = makeSelection({1, 3}, {3, 2});
+        CHECK(sel.anyselected({0, 0}, {1, 3}));
+        CHECK(!sel.anyselected({0, 0}, {1, 2}));
+        CHECK(sel.anyselected({2, 9}, {2, 9}));
+        CHECK(!sel.anyselected({3, 3}, {4, 9}));
+    }
+}
+
+static std::shared_ptr<const screen::screenRow> makeRow(const char* text,
+        int cols, bool wrap = false)
+{
+    auto row = std::make_shared<screen::screenRow>(cols);
+    for (int i = 0; i < cols && text[i]; i++)
+        (*row)[i].u = text[i];
+    (*row)[cols - 1].attr.wrap = wrap;
+    return row;
+}
+
+TEST_CASE("selection text")
+{
+    std::vector<std::shared_ptr<const screen::screenRow>> rows{
+            makeRow("one two", 10),
+            makeRow("wrapped li", 10, true),
+            makeRow("ne", 10),
+            makeRow("last line", 10)};
+
+    SUBCASE("lines end with newlines, wrapped rows don't")
+    {
+        screen::SelectionText text{rows, 10, {0, 4}, {3, 3}, false};
+        CHECK(text.str() == "two\nwrapped line\nlast");
+    }
+
+    SUBCASE("rectangular selections take the same columns of each row")
+    {
+        screen::SelectionText text{rows, 10, {0, 0}, {3, 2}, true};
+        CHECK(text.str() == "one\nwra\nne\nlas");
+    }
+
+    SUBCASE("chunked reads match the whole text")
+    {
+        screen::SelectionText text{rows, 10, {0, 0}, {3, 9}, false};
+        const auto whole = text.str();
+
+        for (std::size_t max : {1, 2, 5, 64}) {
+            text.rewind();
+
+            std::string out;
+            std::string chunk;
+            bool more = true;
+            while (more) {
+                chunk.clear();
+                more = text.read(chunk, max);
+                CHECK(chunk.size() <= max);
+                out += chunk;
+            }
+            CHECK(out == whole);
+        }
+    }
+
+    SUBCASE("reading doesn't move other copies")
+    {
+        screen::SelectionText text{rows, 10, {0, 0}, {3, 9}, false};
+        auto copy = text;
+
+        std::string chunk;
+        text.read(chunk, 4);
+        CHECK(chunk == "one ");
+
+        chunk.clear();
+        copy.read(chunk, 4);
+        CHECK(chunk == "one ");
+    }
+}
+
+TEST_SUITE_END();
@@ -0,0 +1,216 @@
+#include "doctest.h"
+#include "rwte/event.h"
+#include "rwte/headless.h"
+#include "rwte/reactorctrl.h"
+#include "rwte/rwte.h"
+#include "rwte/tty.h"
+#include "rwte/window.h"
+
+#include <poll.h>
+#include <string>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#include <utility>
+
+namespace {
+
+// a reactor that's never run, noting whether the tty wants to write.
+// unless the tty is opened, everything written stays buffered
+class FakeCtrl : public reactor::ReactorCtrl
+{
+public:
+    void set_write(int fd, bool write) { writing = write; }
+    void unreg(int fd) {}
+
+    void queue_refresh(float secs) {}
+    void start_repeat(float secs) {}
+    void stop_repeat() {}
+    void start_blink(float secs) {}
+    void stop_blink() {}
+    void start_sync(float secs) {}
+    void stop_sync() {}
+
+    bool writing = false;
+};
+
+// just enough window for the child's environment
+class NullWindow : public Window
+{
+public:
+#if !defined(BUILD_WAYLAND_ONLY)
+    uint32_t windowid() const { return 0; }
+#endif
+
+    int fd() const { return -1; }
+    void prepare() {}
+    bool event() { return false; }
+    bool check() { return false; }
+    void draw() {}
+    void settitle(std::string_view name) {}
+    void seturgent(bool urgent) {}
+    void bell(int volume) {}
+    void setsel() {}
+    void selpaste() {}
+    void setclip() {}
+    void clippaste() {}
+};
+
+// reads what cat, on a raw pty, echoes back, until len bytes or a
+// second passes without any
+std::string readecho(int fd, std::size_t len)
+{
+    std::string out;
+    char buf[256];
+    pollfd pfd{fd, POLLIN, 0};
+    while (out.size() < len && poll(&pfd, 1, 1000) > 0) {
+        const ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n <= 0)
+            break;
+        out.append(buf, n);
+    }
+    return out;
+}
+
+// counts PasteReady, noting whether the paste was still going
+class PasteWatch
+{
+public:
+    PasteWatch(std::shared_ptr<event::Bus> bus, Tty* tty) :
+        m_bus(std::move(bus)),
+        m_tty(tty),
+        m_reg(m_bus->reg<event::PasteReady, PasteWatch, &PasteWatch::onpasteready>(this))
+    {}
+
+    ~PasteWatch() { m_bus->unreg<event::PasteReady>(m_reg); }
+
+    int ready = 0;
+    bool pasting = false;
+
+private:
+    void onpasteready(const event::PasteReady& evt)
+    {
+        ready++;
+        pasting = m_tty->pasting();
+    }
+
+    std::shared_ptr<event::Bus> m_bus;
+    Tty* m_tty;
+    int m_reg;
+};
+
+} // namespace
+
+TEST_SUITE_BEGIN("tty");
+
+TEST_CASE("paste cancel")
+{
+    FakeCtrl ctrl;
+    headless::Headless h{80, 24, &ctrl};
+    Tty tty{h.bus(), &ctrl, h.termptr()};
+    PasteWatch watch{h.bus(), &tty};
+
+    tty.pastebegin();
+    REQUIRE(tty.pasting());
+
+    SUBCASE("while waiting for room")
+    {
+        // fill it, as a window would, until there's no room left
+        while (tty.pasteroom() > 0)
+            tty.paste(std::string(tty.pasteroom(), 'x'));
+        REQUIRE(watch.ready == 0);
+
+        // the window is waiting on PasteReady to go on
+        tty.pastecancel();
+        CHECK(watch.ready == 1);
+        CHECK_FALSE(watch.pasting);
+        CHECK_FALSE(tty.pasting());
+    }
+
+    SUBCASE("before any data")
+    {
+        tty.pastecancel();
+        CHECK(watch.ready == 1);
+        CHECK_FALSE(tty.pasting());
+    }
+
+    SUBCASE("once ended")
+    {
+        tty.paste("hello");
+        tty.pasteend();
+
+        // dropping what's still buffered wakes nobody
+        tty.pastecancel();
+        CHECK(watch.ready == 0);
+        CHECK_FALSE(tty.pasting());
+    }
+}
+
+TEST_CASE("writes during a bracketed paste")
+{
+    FakeCtrl ctrl;
+    headless::Headless h{80, 24, &ctrl};
+    h.feed("\033[?2004h");
+
+    // cat echoes back whatever the tty writes
+    const auto oldcmd = std::exchange(options.cmd, {"cat"});
+    NullWindow window;
+    Tty tty{h.bus(), &ctrl, h.termptr()};
+    tty.open(&window);
+    options.cmd = oldcmd;
+
+    termios raw{};
+    REQUIRE(tcgetattr(tty.fd(), &raw) == 0);
+    cfmakeraw(&raw);
+    REQUIRE(tcsetattr(tty.fd(), TCSANOW, &raw) == 0);
+
+    auto flush = [&] {
+        while (ctrl.writing)
+            tty.write_ready();
+    };
+
+    tty.pastebegin();
+    tty.paste("abc");
+
+    SUBCASE("wait for the close marker")
+    {
+        // typed mid paste, like a ctrl+c to stop it
+        tty.write("\x03");
+        tty.paste("def");
+        tty.pasteend();
+        tty.write("g");
+        flush();
+
+        const std::string want = "\033[200~abcdef\033[201~\x03g";
+        CHECK(readecho(tty.fd(), want.size()) == want);
+    }
+
+    SUBCASE("follow a cancelled paste")
+    {
+        tty.write("\x03");
+        tty.pastecancel();
+        flush();
+
+        const std::string want = "\033[200~\033[201~\x03";
+        CHECK(readecho(tty.fd(), want.size()) == want);
+    }
+
+    SUBCASE("go ahead of the next paste")
+    {
+        tty.pasteend();
+        tty.write("x");
+        tty.pastebegin();
+        tty.paste("y");
+        tty.pasteend();
+        flush();
+
+        const std::string want =
+                "\033[200~abc\033[201~x\033[200~y\033[201~";
+        CHECK(readecho(tty.fd(), want.size()) == want);
+    }
+
+    tty.hup();
+    waitpid(-1, nullptr, 0);
+}
+
+TEST_SUITE_END();
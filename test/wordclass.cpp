@@ -0,0 +1,45 @@
+#include "doctest.h"
+#include "rwte/wordclass.h"
+
+TEST_SUITE_BEGIN("wordclass");
+
+TEST_CASE("word delimiters")
+{
+    SUBCASE("none by default")
+    {
+        screen::WordClass wc;
+        CHECK(!wc.isdelim(' '));
+        CHECK(!wc.isdelim(0));
+        CHECK(!wc.isdelim(0x1F600));
+    }
+
+    SUBCASE("ascii")
+    {
+        screen::WordClass wc{" '`\"()[]{}<>|"};
+        CHECK(wc.isdelim(' '));
+        CHECK(wc.isdelim('|'));
+        CHECK(wc.isdelim('{'));
+        CHECK(!wc.isdelim('a'));
+        CHECK(!wc.isdelim('_'));
+        CHECK(!wc.isdelim(0));
+    }
+
+    SUBCASE("multibyte")
+    {
+        // no-break space, ideographic space, and a few emoji
+        screen::WordClass wc{" 　\U0001F600\U0001F602\U0001F601\U0001F680"};
+        CHECK(wc.isdelim(0xA0));
+        CHECK(wc.isdelim(0x3000));
+        CHECK(!wc.isdelim(0x3001));
+        CHECK(!wc.isdelim(0x1F5FF));
+        CHECK(wc.isdelim(0x1F600));
+        CHECK(wc.isdelim(0x1F601));
+        CHECK(wc.isdelim(0x1F602));
+        CHECK(!wc.isdelim(0x1F603));
+        CHECK(!wc.isdelim(0x1F67F));
+        CHECK(wc.isdelim(0x1F680));
+        CHECK(!wc.isdelim(0x1F681));
+    }
+}
+
+TEST_SUITE_END();